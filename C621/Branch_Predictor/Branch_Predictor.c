@@ -1,56 +1,268 @@
 #include "Branch_Predictor.h"
 
+#include <sys/mman.h>
+
 const unsigned instShiftAmt = 2; // Number of bits to shift a PC by
 
 // You can play around with these settings.
-const unsigned localPredictorSize = 2048;   // two-bit
+const unsigned localPredictorSize = 2048;   // two-bit, Tournament local counter and history tables
 const unsigned localCounterBits = 2;        //two-bit
-const unsigned localHistoryTableSize = 2048;// Tournament
 const unsigned globalPredictorSize = 32768; // Tournament & gshare
 const unsigned globalCounterBits = 64;       // Tournament, gshare, Perceptron, 12-64, also update main.c for recod keeping
 const unsigned choicePredictorSize = 8192;  // Tournament Keep this the same as globalPredictorSize.
 const unsigned choiceCounterBits = 2;       // Tournament ~
 const unsigned perceptronSize = 32768;
+const unsigned hashedPerceptronTables = 8;     // Hashed perceptron
+const unsigned hashedPerceptronSize = 4096;    // Hashed perceptron, entries per table
+const unsigned hashedPerceptronHistory = 64;   // Hashed perceptron, longest history, up to 64
 
 Branch_Predictor *initBranchPredictor()
+{
+    Predictor_Config config;
+    initPredictorConfig(&config, PERCEPTRON);
+
+    return initBranchPredictorConfig(&config);
+}
+
+// Default configuration of each predictor type, from the settings above
+void initPredictorConfig(Predictor_Config *config, Predictor_Type type)
+{
+    config->type = type;
+    config->threshold = 0;
+    config->counter_bits = type == TWO_BIT_LOCAL ? localCounterBits : choiceCounterBits;
+    config->local_size = localPredictorSize;
+    config->num_tables = hashedPerceptronTables;
+
+    switch (type)
+    {
+        case TWO_BIT_LOCAL:
+            config->table_size = localPredictorSize;
+            config->history_bits = 0;
+            break;
+        case TOURNAMENT:
+            config->table_size = globalPredictorSize;
+            config->history_bits = 0;
+            break;
+        case GSHARE:
+            config->table_size = globalPredictorSize;
+            config->history_bits = 0;
+            break;
+        case PERCEPTRON:
+            config->table_size = perceptronSize;
+            config->history_bits = globalCounterBits;
+            break;
+        case HASHED_PERCEPTRON:
+            config->table_size = hashedPerceptronSize;
+            config->history_bits = hashedPerceptronHistory;
+            break;
+    }
+}
+
+bool checkPredictorConfig(const Predictor_Config *config)
+{
+    if (config->type > HASHED_PERCEPTRON || !checkPowerofTwo(config->table_size))
+    {
+        return false;
+    }
+
+    switch (config->type)
+    {
+        case TWO_BIT_LOCAL:
+        case GSHARE:
+            return config->counter_bits > 0 && config->counter_bits <= 64;
+        case TOURNAMENT:
+            return config->counter_bits > 0 && config->counter_bits <= 64 &&
+                   checkPowerofTwo(config->local_size);
+        case PERCEPTRON:
+            return config->history_bits > 0 && config->history_bits <= 64;
+        case HASHED_PERCEPTRON:
+            return config->num_tables >= HP_MIN_TABLES && config->num_tables <= HP_MAX_TABLES &&
+                   config->table_size >= 2;
+    }
+    return false;
+}
+
+Branch_Predictor *initBranchPredictorConfig(const Predictor_Config *config)
 {
     Branch_Predictor *branch_predictor = (Branch_Predictor *)malloc(sizeof(Branch_Predictor));
-	
-   // Perceptron
-	
-	branch_predictor->global_predictor_size = globalPredictorSize;
-    branch_predictor->global_history_mask = globalPredictorSize - 1;
+    memset(branch_predictor, 0, sizeof(Branch_Predictor));
+
+    branch_predictor->type = config->type;
     branch_predictor->global_history = 0; // global history register
-    
-	// Initialize global counters
-    branch_predictor->global_counters = (Sat_Counter *)malloc(globalPredictorSize * sizeof(Sat_Counter));
-    
-	for (int i = 0; i < globalPredictorSize; i++)
-	{
-        initSatCounter(&(branch_predictor->global_counters[i]), globalCounterBits);
-	}
-	
-    assert(checkPowerofTwo(perceptronSize));
 
-    branch_predictor -> perceptron_size = perceptronSize;
+    // Tables are heap allocated until a snapshot is restored on top of them
+    branch_predictor -> snapshot_base = NULL;
+    branch_predictor -> snapshot_len = 0;
 
-    // Initialize threshold for branch prediction
-    branch_predictor -> threshold =1.93 * globalCounterBits + 14; // best threshold given history length of h (found on page 201)
+    assert(checkPowerofTwo(config->table_size));
 
-    unsigned perceptronBit = 1 + floor(log2(branch_predictor -> threshold));
+    if (config->type == TWO_BIT_LOCAL)
+    {
+        branch_predictor->local_predictor_size = config->table_size;
+        branch_predictor->local_predictor_mask = config->table_size - 1;
 
-    branch_predictor -> perceptron_mask = perceptronSize - 1;
+        // Initialize sat counters
+        branch_predictor->local_counters = (Sat_Counter *)malloc(config->table_size * sizeof(Sat_Counter));
 
-    branch_predictor -> perceptron = (Perceptron *)malloc(perceptronSize * sizeof(Perceptron));
+        for (int i = 0; i < config->table_size; i++)
+        {
+            initSatCounter(&(branch_predictor->local_counters[i]), config->counter_bits);
+        }
+    }
 
-    for (int i = 0; i < perceptronSize; i++)
+    if (config->type == TOURNAMENT)
     {
-        initPerceptron(&(branch_predictor->perceptron[i]), globalCounterBits);
+        assert(checkPowerofTwo(config->local_size));
+
+        // Initialize local predictor
+        branch_predictor->local_predictor_size = config->local_size;
+        branch_predictor->local_predictor_mask = config->local_size - 1;
+        branch_predictor->local_counters = (Sat_Counter *)malloc(config->local_size * sizeof(Sat_Counter));
+
+        for (int i = 0; i < config->local_size; i++)
+        {
+            initSatCounter(&(branch_predictor->local_counters[i]), localCounterBits);
+        }
+
+        branch_predictor->local_history_table_size = config->local_size;
+        branch_predictor->local_history_table_mask = config->local_size - 1;
+        branch_predictor->local_history_table = (unsigned *)calloc(config->local_size, sizeof(unsigned));
+
+        // Initialize global and choice predictors, both indexed by the global history
+        branch_predictor->global_predictor_size = config->table_size;
+        branch_predictor->global_history_mask = config->table_size - 1;
+        branch_predictor->global_counters = (Sat_Counter *)malloc(config->table_size * sizeof(Sat_Counter));
+
+        branch_predictor->choice_predictor_size = config->table_size;
+        branch_predictor->choice_history_mask = config->table_size - 1;
+        branch_predictor->choice_counters = (Sat_Counter *)malloc(config->table_size * sizeof(Sat_Counter));
+
+        for (int i = 0; i < config->table_size; i++)
+        {
+            initSatCounter(&(branch_predictor->global_counters[i]), config->counter_bits);
+            initSatCounter(&(branch_predictor->choice_counters[i]), choiceCounterBits);
+        }
+    }
+
+    if (config->type == GSHARE)
+    {
+        branch_predictor->global_predictor_size = config->table_size;
+        branch_predictor->global_history_mask = config->table_size - 1;
+
+        // A history length of 0 uses as many bits as the table is indexed by
+        if (config->history_bits > 0 && config->history_bits < 64)
+        {
+            branch_predictor->global_history_mask &= (1ULL << config->history_bits) - 1;
+        }
+
+        branch_predictor->global_counters = (Sat_Counter *)malloc(config->table_size * sizeof(Sat_Counter));
+
+        for (int i = 0; i < config->table_size; i++)
+        {
+            initSatCounter(&(branch_predictor->global_counters[i]), config->counter_bits);
+        }
+    }
+
+    if (config->type == PERCEPTRON)
+    {
+        unsigned history_bits = config->history_bits;
+
+        branch_predictor->global_predictor_size = config->table_size;
+        branch_predictor->global_history_mask = config->table_size - 1;
+
+        // Initialize global counters
+        branch_predictor->global_counters = (Sat_Counter *)malloc(config->table_size * sizeof(Sat_Counter));
+
+        for (int i = 0; i < config->table_size; i++)
+        {
+            initSatCounter(&(branch_predictor->global_counters[i]), history_bits);
+        }
+
+        branch_predictor -> perceptron_size = config->table_size;
+
+        // Initialize threshold for branch prediction
+        branch_predictor -> threshold = config->threshold;
+        if (config->threshold == 0)
+        {
+            branch_predictor -> threshold =1.93 * history_bits + 14; // best threshold given history length of h (found on page 201)
+        }
+
+        branch_predictor -> perceptron_mask = config->table_size - 1;
+
+        branch_predictor -> perceptron = (Perceptron *)malloc(config->table_size * sizeof(Perceptron));
+
+        for (int i = 0; i < config->table_size; i++)
+        {
+            initPerceptron(&(branch_predictor->perceptron[i]), history_bits);
+        }
+    }
+
+    if (config->type == HASHED_PERCEPTRON)
+    {
+        unsigned max_history = config->history_bits;
+        if (max_history == 0 || max_history > 64)
+        {
+            max_history = hashedPerceptronHistory;
+        }
+
+        unsigned num_tables = config->num_tables;
+        assert(num_tables >= HP_MIN_TABLES && num_tables <= HP_MAX_TABLES);
+
+        branch_predictor->hp_num_tables = num_tables;
+        branch_predictor->hp_index_bits = log2(config->table_size);
+        branch_predictor->hp_table_mask = config->table_size - 1;
+
+        // Table 0 is indexed by the PC alone; the others use geometric
+        // history lengths 2 .. max_history, as in O-GEHL
+        branch_predictor->hp_history_lengths[0] = 0;
+        for (int i = 1; i < num_tables; i++)
+        {
+            double ratio = pow((double)max_history / 2, (double)(i - 1) / (num_tables - 2));
+            branch_predictor->hp_history_lengths[i] = (unsigned)(2 * ratio + 0.5);
+        }
+
+        branch_predictor->hp_weights = (int8_t *)calloc((size_t)num_tables * config->table_size, sizeof(int8_t));
+
+        // O-GEHL starts the threshold at the number of tables
+        branch_predictor->hp_threshold = config->threshold ? config->threshold : num_tables;
+        branch_predictor->hp_threshold_counter = 0;
     }
 
     return branch_predictor;
 }
 
+void freeBranchPredictor(Branch_Predictor *branch_predictor)
+{
+    free(branch_predictor->local_counters);
+    free(branch_predictor->local_history_table);
+    free(branch_predictor->choice_counters);
+    free(branch_predictor->hp_weights);
+
+    if (branch_predictor->perceptron != NULL)
+    {
+        // A restored snapshot maps the counters and weights in place
+        if (branch_predictor->snapshot_base == NULL)
+        {
+            for (int i = 0; i < branch_predictor->perceptron_size; i++)
+            {
+                free(branch_predictor->perceptron[i].weight);
+            }
+        }
+        free(branch_predictor->perceptron);
+    }
+
+    if (branch_predictor->snapshot_base != NULL)
+    {
+        munmap(branch_predictor->snapshot_base, branch_predictor->snapshot_len);
+    }
+    else
+    {
+        free(branch_predictor->global_counters);
+    }
+
+    free(branch_predictor);
+}
+
 // sat counter functions
 inline void initSatCounter(Sat_Counter *sat_counter, unsigned counter_bits)
 {
@@ -79,13 +291,126 @@ inline void decrementCounter(Sat_Counter *sat_counter)
 bool predict(Branch_Predictor *branch_predictor, Instruction *instr)
 {
     uint64_t branch_address = instr -> PC;
-	
+
+    if (branch_predictor->type == TWO_BIT_LOCAL)
+    {
+        // Step one, get prediction
+        unsigned local_index = getIndex(branch_address, branch_predictor->local_predictor_mask);
+
+        bool prediction = getPrediction(&(branch_predictor->local_counters[local_index]));
+
+        // Step two, update counter
+        if (instr->taken)
+        {
+            incrementCounter(&(branch_predictor->local_counters[local_index]));
+        }
+        else
+        {
+            decrementCounter(&(branch_predictor->local_counters[local_index]));
+        }
+
+        return prediction == instr->taken;
+    }
+
+    if (branch_predictor->type == TOURNAMENT)
+    {
+        // Step one, get local prediction.
+        unsigned local_history_table_idx = getIndex(branch_address, branch_predictor->local_history_table_mask);
+
+        unsigned local_predictor_idx = branch_predictor->local_history_table[local_history_table_idx] &
+                                       branch_predictor->local_predictor_mask;
+
+        bool local_prediction = getPrediction(&(branch_predictor->local_counters[local_predictor_idx]));
+
+        // Step two, get global prediction.
+        unsigned global_predictor_idx = branch_predictor->global_history & branch_predictor->global_history_mask;
+
+        bool global_prediction = getPrediction(&(branch_predictor->global_counters[global_predictor_idx]));
+
+        // Step three, get choice prediction.
+        unsigned choice_predictor_idx = branch_predictor->global_history & branch_predictor->choice_history_mask;
+
+        bool choice_prediction = getPrediction(&(branch_predictor->choice_counters[choice_predictor_idx]));
+
+        // Step four, final prediction.
+        bool final_prediction = choice_prediction ? global_prediction : local_prediction;
+
+        bool prediction_correct = final_prediction == instr->taken;
+
+        // Step five, update counters
+        if (local_prediction != global_prediction)
+        {
+            if (local_prediction == instr->taken)
+            {
+                // Should be more favorable towards local predictor.
+                decrementCounter(&(branch_predictor->choice_counters[choice_predictor_idx]));
+            }
+            else
+            {
+                // Should be more favorable towards global predictor.
+                incrementCounter(&(branch_predictor->choice_counters[choice_predictor_idx]));
+            }
+        }
+
+        if (instr->taken)
+        {
+            incrementCounter(&(branch_predictor->global_counters[global_predictor_idx]));
+            incrementCounter(&(branch_predictor->local_counters[local_predictor_idx]));
+        }
+        else
+        {
+            decrementCounter(&(branch_predictor->global_counters[global_predictor_idx]));
+            decrementCounter(&(branch_predictor->local_counters[local_predictor_idx]));
+        }
+
+        // Step six, update global and local history registers
+        branch_predictor->global_history = branch_predictor->global_history << 1 | instr->taken;
+        branch_predictor->local_history_table[local_history_table_idx] =
+            branch_predictor->local_history_table[local_history_table_idx] << 1 | instr->taken;
+
+        return prediction_correct;
+    }
+
+    if (branch_predictor->type == GSHARE)
+    {
+        // Step one, get prediction
+        unsigned global_predictor_idx = (branch_predictor->global_history ^ (branch_address >> instShiftAmt)) &
+                                        (branch_predictor->global_predictor_size - 1);
+
+        bool prediction = getPrediction(&(branch_predictor->global_counters[global_predictor_idx]));
+
+        // Step two, update counter
+        if (instr->taken)
+        {
+            incrementCounter(&(branch_predictor->global_counters[global_predictor_idx]));
+        }
+        else
+        {
+            decrementCounter(&(branch_predictor->global_counters[global_predictor_idx]));
+        }
+
+        // Step three, update global history register
+        branch_predictor->global_history = (branch_predictor->global_history << 1 | instr->taken) &
+                                           branch_predictor->global_history_mask;
+
+        return prediction == instr->taken;
+    }
+
+    if (branch_predictor->type == HASHED_PERCEPTRON)
+    {
+        return predictHashedPerceptron(branch_predictor, instr);
+    }
+
+    // Perceptron
     // Step one, get prediction
     unsigned perceptron_idx = (branch_predictor->global_history & branch_predictor->global_history_mask) ^ (branch_address & branch_predictor->global_history_mask);
 
     int64_t y = computePerceptron(&(branch_predictor -> perceptron[perceptron_idx]), &(branch_predictor -> global_counters[perceptron_idx]));
     train(&(branch_predictor -> perceptron[perceptron_idx]), branch_predictor -> threshold, &(branch_predictor -> global_counters[perceptron_idx]), instr -> taken, y);
 
+    branch_predictor -> last_output = y;
+    branch_predictor -> last_threshold = branch_predictor -> threshold;
+
     bool prediction = (y > 0);
     
     return prediction == instr -> taken;
@@ -94,7 +419,8 @@ bool predict(Branch_Predictor *branch_predictor, Instruction *instr)
 // Perceptron
 inline void initPerceptron(Perceptron *perceptron, unsigned counter_bits)
 {
-	perceptron -> weight = (int64_t *)malloc(counter_bits * sizeof(int64_t));
+	// weight[0] is the bias, weight[1..counter_bits] follow the history bits
+	perceptron -> weight = (int64_t *)malloc((counter_bits + 1) * sizeof(int64_t));
 	
 	for(int i = 0; i <= counter_bits; i++)
 	perceptron -> weight[i] = 1;    
@@ -135,6 +461,105 @@ inline void train( Perceptron *perceptron, unsigned threshold, Sat_Counter *glob
 	}
 }
 
+// Hashed perceptron
+bool predictHashedPerceptron(Branch_Predictor *branch_predictor, Instruction *instr)
+{
+    unsigned num_tables = branch_predictor->hp_num_tables;
+    unsigned table_size = branch_predictor->hp_table_mask + 1;
+
+    // Step one, one weight per table, summed
+    int8_t *weights[HP_MAX_TABLES];
+    int y = 0;
+    int i;
+    for (i = 0; i < num_tables; i++)
+    {
+        unsigned idx = getHashedIndex(instr->PC, branch_predictor->global_history,
+                                      branch_predictor->hp_history_lengths[i],
+                                      branch_predictor->hp_index_bits);
+
+        weights[i] = &(branch_predictor->hp_weights[(size_t)i * table_size + idx]);
+        y += *weights[i];
+    }
+
+    bool prediction = (y >= 0);
+    bool correct = prediction == instr->taken;
+    int magnitude = y < 0 ? -y : y;
+
+    branch_predictor->last_output = y;
+    branch_predictor->last_threshold = branch_predictor->hp_threshold;
+
+    // Step two, train on a misprediction or a low-confidence output
+    if (!correct || magnitude <= branch_predictor->hp_threshold)
+    {
+        for (i = 0; i < num_tables; i++)
+        {
+            if (instr->taken && *weights[i] < INT8_MAX)
+            {
+                ++*weights[i];
+            }
+            else if (!instr->taken && *weights[i] > INT8_MIN)
+            {
+                --*weights[i];
+            }
+        }
+    }
+
+    // Step three, adapt the threshold so that mispredictions and
+    // low-confidence updates stay roughly balanced
+    if (!correct)
+    {
+        if (++branch_predictor->hp_threshold_counter >= 63)
+        {
+            ++branch_predictor->hp_threshold;
+            branch_predictor->hp_threshold_counter = 0;
+        }
+    }
+    else if (magnitude <= branch_predictor->hp_threshold)
+    {
+        if (--branch_predictor->hp_threshold_counter <= -64)
+        {
+            if (branch_predictor->hp_threshold > 0)
+            {
+                --branch_predictor->hp_threshold;
+            }
+            branch_predictor->hp_threshold_counter = 0;
+        }
+    }
+
+    // Step four, update global history register
+    branch_predictor->global_history = branch_predictor->global_history << 1 | instr->taken;
+
+    return correct;
+}
+
+// Hash the PC with the youngest history_len bits of global history, the
+// history being xor-folded down to index_bits
+unsigned getHashedIndex(uint64_t branch_addr, uint64_t history, unsigned history_len, unsigned index_bits)
+{
+    uint64_t pc = branch_addr >> instShiftAmt;
+    uint64_t index_mask = (1ULL << index_bits) - 1;
+
+    if (history_len < 64)
+    {
+        history &= (1ULL << history_len) - 1;
+    }
+
+    // A one-entry table has no index bits to fold into
+    if (index_bits == 0)
+    {
+        return 0;
+    }
+
+    uint64_t folded = 0;
+    while (history != 0)
+    {
+        folded ^= history & index_mask;
+        history >>= index_bits;
+    }
+
+    return (pc ^ (pc >> index_bits) ^ folded ^ (history_len * 0x9E37)) & index_mask;
+}
+
 inline unsigned getIndex(uint64_t branch_addr, unsigned index_mask)
 {
     return (branch_addr >> instShiftAmt) & index_mask;
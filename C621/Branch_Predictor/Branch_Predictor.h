@@ -6,14 +6,28 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <math.h>
+#include <string.h>
 
 #include "Instruction.h"
 
 // Predictor type
-//#define TWO_BIT_LOCAL
-//#define TOURNAMENT
-//#define GSHARE
-#define PERCEPTRON
+typedef enum Predictor_Type{TWO_BIT_LOCAL, TOURNAMENT, GSHARE, PERCEPTRON, HASHED_PERCEPTRON}Predictor_Type;
+
+#define HP_MIN_TABLES 3 // The PC table, then history lengths from 2 to the longest
+#define HP_MAX_TABLES 16
+
+typedef struct Predictor_Config
+{
+    Predictor_Type type;
+
+    unsigned table_size; // Entries of the main table (local, global, perceptron or each hashed table)
+    unsigned history_bits; // (Longest) global history length, 0 for the default
+    unsigned threshold; // (Initial) perceptron training threshold, 0 for the default
+
+    unsigned counter_bits; // Width of the two-bit local, gshare and tournament global counters
+    unsigned local_size; // Tournament local counter and history tables
+    unsigned num_tables; // Hashed perceptron weight tables, HP_MIN_TABLES to HP_MAX_TABLES
+}Predictor_Config;
 
 // saturating counter
 typedef struct Sat_Counter
@@ -33,6 +47,22 @@ typedef struct Perceptron
 
 typedef struct Branch_Predictor
 {
+    Predictor_Type type;
+
+    // Two-bit local and Tournament
+    unsigned local_predictor_size;
+    unsigned local_predictor_mask;
+    Sat_Counter *local_counters;
+
+    unsigned local_history_table_size;
+    unsigned local_history_table_mask;
+    unsigned *local_history_table;
+
+    // Tournament
+    unsigned choice_predictor_size;
+    unsigned choice_history_mask;
+    Sat_Counter *choice_counters;
+
 	unsigned global_predictor_size;
     unsigned global_history_mask;
     Sat_Counter *global_counters;
@@ -43,11 +73,35 @@ typedef struct Branch_Predictor
     unsigned perceptron_size;
     unsigned threshold;
     Perceptron *perceptron;
+
+    // Hashed perceptron: small weight tables, each indexed by the PC hashed
+    // with a different (geometric) length of global history
+    unsigned hp_num_tables;
+    unsigned hp_index_bits;
+    unsigned hp_table_mask;
+    unsigned hp_history_lengths[HP_MAX_TABLES];
+    int8_t *hp_weights; // hp_num_tables x (hp_table_mask + 1)
+    int hp_threshold; // Adaptive training threshold
+    int hp_threshold_counter; // Steers the threshold (O-GEHL)
+
+    // Perceptrons: output y of the last prediction and the training
+    // threshold it was compared against, |y| <= threshold is low confidence
+    int64_t last_output;
+    int64_t last_threshold;
+
+    // Snapshot mapping backing the tables (see Snapshot.c), NULL if none
+    void *snapshot_base;
+    size_t snapshot_len;
     
 } Branch_Predictor;
 
 // Initialization function
 Branch_Predictor *initBranchPredictor();
+void initPredictorConfig(Predictor_Config *config, Predictor_Type type);
+// Reject what initBranchPredictorConfig() would assert on
+bool checkPredictorConfig(const Predictor_Config *config);
+Branch_Predictor *initBranchPredictorConfig(const Predictor_Config *config);
+void freeBranchPredictor(Branch_Predictor *branch_predictor);
 
 // Counter functions
 void initSatCounter(Sat_Counter *sat_counter, unsigned counter_bits);
@@ -62,6 +116,10 @@ void initPerceptron(Perceptron *perceptron, unsigned counter_bits);
 int64_t computePerceptron(Perceptron *perceptron, Sat_Counter *sat_counter);
 void train(Perceptron *perceptron, unsigned threshold, Sat_Counter * sat_counter, bool is_taken, int64_t y);
 
+// Hashed perceptron
+bool predictHashedPerceptron(Branch_Predictor *branch_predictor, Instruction *instr);
+unsigned getHashedIndex(uint64_t branch_addr, uint64_t history, unsigned history_len, unsigned index_bits);
+
 unsigned getIndex(uint64_t branch_addr, unsigned index_mask);
 bool getPrediction(Sat_Counter *sat_counter);
 
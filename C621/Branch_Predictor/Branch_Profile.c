@@ -0,0 +1,106 @@
+#include "Branch_Profile.h"
+
+Branch_Profile *initBranchProfile(unsigned top_k, const Branch_Predictor *branch_predictor)
+{
+    Branch_Profile *profile = (Branch_Profile *)calloc(1, sizeof(Branch_Profile));
+    profile->top_k = top_k;
+
+    unsigned num_slots = top_k * BRANCH_PROFILE_SLOTS_PER_ROW;
+    if (num_slots < 256)
+    {
+        num_slots = 256;
+    }
+    profile->sketch = initSpaceSaving(num_slots);
+    profile->slots = (Branch_Slot *)calloc(num_slots, sizeof(Branch_Slot));
+
+    profile->confidence = branch_predictor->type == PERCEPTRON ||
+                          branch_predictor->type == HASHED_PERCEPTRON;
+
+    return profile;
+}
+
+void freeBranchProfile(Branch_Profile *profile)
+{
+    freeSpaceSaving(profile->sketch);
+    free(profile->slots);
+    free(profile);
+}
+
+void profileBranch(Branch_Profile *profile, const Branch_Predictor *branch_predictor,
+                   const Instruction *instr, bool correct)
+{
+    ++profile->branches;
+    profile->mispredictions += !correct;
+
+    int slot = findSketchKey(profile->sketch, instr->PC);
+    if (slot < 0)
+    {
+        if (correct)
+        {
+            return;
+        }
+        slot = admitSketchKey(profile->sketch, instr->PC);
+        memset(&(profile->slots[slot]), 0, sizeof(Branch_Slot));
+    }
+
+    Branch_Slot *entry = &(profile->slots[slot]);
+    ++entry->executions;
+    entry->taken += instr->taken != 0;
+
+    if (profile->confidence)
+    {
+        int64_t y = branch_predictor->last_output;
+        uint64_t magnitude = y < 0 ? -y : y;
+        entry->sum_output += magnitude;
+        entry->low_confidence += magnitude <= branch_predictor->last_threshold;
+    }
+
+    if (!correct)
+    {
+        countSketchSlot(profile->sketch, slot);
+    }
+}
+
+/* Report */
+void printBranchProfile(Branch_Profile *profile)
+{
+    const Space_Saving *sketch = profile->sketch;
+    unsigned *ranked = rankSketchSlots(sketch);
+
+    printf("Top mispredicted branches (%u tracked of %u slots):\n", sketch->num_used,
+           sketch->num_slots);
+    printf("%-4s %16s %12s %8s %8s %8s %12s %8s %8s", "Rank", "PC", "Mispredicts", "(+/-)",
+           "Share", "Cumul", "Executions", "Mispred", "Taken");
+    if (profile->confidence)
+    {
+        printf(" %8s %8s", "Low conf", "Avg |y|");
+    }
+    printf("\n");
+
+    double mispredictions = profile->mispredictions ? profile->mispredictions : 1;
+    uint64_t cumulative = 0;
+    unsigned i;
+    for (i = 0; i < sketch->num_used && i < profile->top_k; i++)
+    {
+        unsigned slot = ranked[i];
+        Branch_Slot *entry = &(profile->slots[slot]);
+        uint64_t branch_mispredictions = sketch->counts[slot];
+        cumulative += branch_mispredictions;
+
+        double executions = entry->executions ? entry->executions : 1;
+        printf("%-4u %16"PRIu64" %12"PRIu64" %8"PRIu64" %7.2f%% %7.2f%% %12"PRIu64" %7.2f%% %7.2f%%",
+               i + 1, sketch->keys[slot], branch_mispredictions, sketch->errors[slot],
+               100.0 * branch_mispredictions / mispredictions,
+               100.0 * cumulative / mispredictions, entry->executions,
+               100.0 * (branch_mispredictions - sketch->errors[slot]) / executions,
+               100.0 * entry->taken / executions);
+        if (profile->confidence)
+        {
+            printf(" %7.2f%% %8.1f", 100.0 * entry->low_confidence / executions,
+                   entry->sum_output / executions);
+        }
+        printf("\n");
+    }
+
+    free(ranked);
+}
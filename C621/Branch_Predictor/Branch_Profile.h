@@ -0,0 +1,51 @@
+#ifndef __BRANCH_PROFILE_HH__
+#define __BRANCH_PROFILE_HH__
+
+#include "Branch_Predictor.h"
+#include "Space_Saving.h"
+
+// Per-PC misprediction profile in fixed memory, whatever the number of
+// distinct branches. A space-saving sketch (see Space_Saving.h) keyed by PC
+// keeps the branches with the most mispredictions in num_slots counters;
+// a mispredicted branch that is not tracked takes over the slot with the
+// fewest, inheriting its count as an overestimate (error).
+//
+// A tracked branch also counts its executions, taken outcomes and
+// perceptron confidence (|y| against the training threshold) from the
+// moment it got its slot, so those are exact when its error is 0.
+#define BRANCH_PROFILE_SLOTS_PER_ROW 16 // Slots per reported branch, at least 256
+#define BRANCH_PROFILE_MAX_TOP 65536 // Branches reported at most
+
+// Per sketch slot, since the branch got it
+typedef struct Branch_Slot
+{
+    uint64_t executions;
+    uint64_t taken;
+    uint64_t low_confidence; // Executions with |y| <= threshold
+    uint64_t sum_output; // Sum of |y|
+}Branch_Slot;
+
+typedef struct Branch_Profile
+{
+    unsigned top_k; // Branches reported
+
+    Space_Saving *sketch; // PC to mispredictions
+    Branch_Slot *slots;
+
+    bool confidence; // The predictor is a perceptron
+
+    uint64_t branches;
+    uint64_t mispredictions;
+}Branch_Profile;
+
+Branch_Profile *initBranchProfile(unsigned top_k, const Branch_Predictor *branch_predictor);
+void freeBranchProfile(Branch_Profile *profile);
+
+// Account one prediction made by branch_predictor, right after predict()
+void profileBranch(Branch_Profile *profile, const Branch_Predictor *branch_predictor,
+                   const Instruction *instr, bool correct);
+
+// The top_k branches by mispredictions, with their share of all of them
+void printBranchProfile(Branch_Profile *profile);
+
+#endif
@@ -0,0 +1,299 @@
+#include "Evaluate.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "Trace.h"
+
+static const char *type_names[] = {"local", "tournament", "gshare", "perceptron", "hashed"};
+
+// A decimal field from 0 to UINT_MAX, anything else (signs included) is rejected
+static bool parseField(const char *field, unsigned *value)
+{
+    char *end;
+    errno = 0;
+    unsigned long parsed = strtoul(field, &end, 10);
+    if (!isdigit((unsigned char)field[0]) || *end != '\0' || errno != 0 || parsed > UINT_MAX)
+    {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+bool parsePredictorConfig(const char *spec, Predictor_Config *config)
+{
+    char buf[128];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *ptr = strtok(buf, ":");
+    if (ptr == NULL)
+    {
+        return false;
+    }
+
+    int type;
+    for (type = 0; type < sizeof(type_names) / sizeof(type_names[0]); type++)
+    {
+        if (strcmp(ptr, type_names[type]) == 0)
+        {
+            break;
+        }
+    }
+    if (type == sizeof(type_names) / sizeof(type_names[0]))
+    {
+        fprintf(stderr, "Unknown predictor type: %s\n", ptr);
+        return false;
+    }
+    initPredictorConfig(config, (Predictor_Type)type);
+
+    unsigned *fields[] = {&config->table_size, &config->history_bits, &config->threshold};
+    unsigned i;
+    for (i = 0; i < sizeof(fields) / sizeof(fields[0]) && (ptr = strtok(NULL, ":")) != NULL; i++)
+    {
+        if (!parseField(ptr, fields[i]))
+        {
+            fprintf(stderr, "%s: %s is not a number\n", spec, ptr);
+            return false;
+        }
+    }
+    if (strtok(NULL, ":") != NULL)
+    {
+        fprintf(stderr, "%s: too many fields\n", spec);
+        return false;
+    }
+
+    if (!checkPowerofTwo(config->table_size))
+    {
+        fprintf(stderr, "%s: table size must be a power of two\n", spec);
+        return false;
+    }
+    if (config->type == HASHED_PERCEPTRON && config->table_size < 2)
+    {
+        fprintf(stderr, "%s: hashed tables need at least 2 entries\n", spec);
+        return false;
+    }
+    if (config->type == PERCEPTRON && (config->history_bits == 0 || config->history_bits > 64))
+    {
+        fprintf(stderr, "%s: perceptron history must be 1 to 64 bits\n", spec);
+        return false;
+    }
+    // Anything else initBranchPredictorConfig() would assert on
+    if (!checkPredictorConfig(config))
+    {
+        fprintf(stderr, "%s: invalid predictor configuration\n", spec);
+        return false;
+    }
+
+    return true;
+}
+
+typedef struct Eval_Shared
+{
+    Instruction *batches[2]; // Double-buffered branch batches
+    unsigned batch_len[2];
+    unsigned cur; // Batch the workers process next
+    bool done;
+
+    pthread_barrier_t barrier;
+}Eval_Shared;
+
+typedef struct Eval_Worker
+{
+    Eval_Shared *shared;
+
+    // Predictors this worker owns
+    unsigned num_predictors;
+    Branch_Predictor **predictors;
+    Eval_Result **results;
+
+    pthread_t thread;
+}Eval_Worker;
+
+static void *runWorker(void *arg)
+{
+    Eval_Worker *worker = (Eval_Worker *)arg;
+    Eval_Shared *shared = worker->shared;
+
+    while (true)
+    {
+        // Wait for the decoder to publish a batch
+        pthread_barrier_wait(&shared->barrier);
+        if (shared->done)
+        {
+            break;
+        }
+
+        Instruction *batch = shared->batches[shared->cur];
+        unsigned len = shared->batch_len[shared->cur];
+
+        // Predictor-major order keeps one predictor's tables hot at a time
+        int p, i;
+        for (p = 0; p < worker->num_predictors; p++)
+        {
+            Branch_Predictor *branch_predictor = worker->predictors[p];
+            uint64_t incorrect = 0;
+
+            for (i = 0; i < len; i++)
+            {
+                if (!predict(branch_predictor, &(batch[i])))
+                {
+                    ++incorrect;
+                }
+            }
+
+            worker->results[p]->num_of_branches += len;
+            worker->results[p]->num_of_incorrect_predictions += incorrect;
+        }
+
+        // Hand the batch back to the decoder
+        pthread_barrier_wait(&shared->barrier);
+    }
+
+    return NULL;
+}
+
+// Fill a batch with the next branches of the trace
+static unsigned decodeBatch(TraceParser **cpu_trace, Instruction *batch, uint64_t *num_of_instructions)
+{
+    unsigned len = 0;
+
+    while (len < EVAL_BATCH_SIZE && *cpu_trace != NULL)
+    {
+        if (!getInstruction(*cpu_trace))
+        {
+            *cpu_trace = NULL; // getInstruction() released the parser
+            break;
+        }
+
+        if ((*cpu_trace)->cur_instr->instr_type == BRANCH)
+        {
+            batch[len++] = *((*cpu_trace)->cur_instr);
+        }
+        ++(*num_of_instructions);
+    }
+
+    return len;
+}
+
+uint64_t evaluatePredictors(const char *trace_file, Eval_Result *results,
+                            unsigned num_predictors, unsigned num_threads)
+{
+    if (num_threads > num_predictors)
+    {
+        num_threads = num_predictors;
+    }
+    if (num_threads == 0)
+    {
+        num_threads = 1;
+    }
+
+    Eval_Shared shared;
+    shared.batches[0] = (Instruction *)malloc(EVAL_BATCH_SIZE * sizeof(Instruction));
+    shared.batches[1] = (Instruction *)malloc(EVAL_BATCH_SIZE * sizeof(Instruction));
+    shared.cur = 0;
+    shared.done = false;
+    pthread_barrier_init(&shared.barrier, NULL, num_threads + 1);
+
+    // Shard predictors round-robin over the workers
+    Eval_Worker *workers = (Eval_Worker *)calloc(num_threads, sizeof(Eval_Worker));
+    int i;
+    for (i = 0; i < num_threads; i++)
+    {
+        workers[i].shared = &shared;
+        workers[i].predictors = (Branch_Predictor **)malloc(num_predictors * sizeof(Branch_Predictor *));
+        workers[i].results = (Eval_Result **)malloc(num_predictors * sizeof(Eval_Result *));
+    }
+    for (i = 0; i < num_predictors; i++)
+    {
+        Eval_Worker *worker = &(workers[i % num_threads]);
+
+        results[i].num_of_branches = 0;
+        results[i].num_of_incorrect_predictions = 0;
+
+        Branch_Predictor *branch_predictor = initBranchPredictorConfig(&(results[i].config));
+        results[i].threshold = branch_predictor->type == PERCEPTRON ? branch_predictor->threshold :
+                               branch_predictor->type == HASHED_PERCEPTRON ?
+                               branch_predictor->hp_threshold : 0;
+
+        worker->predictors[worker->num_predictors] = branch_predictor;
+        worker->results[worker->num_predictors] = &(results[i]);
+        ++worker->num_predictors;
+    }
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_create(&(workers[i].thread), NULL, runWorker, &(workers[i]));
+    }
+
+    // Decode batch k + 1 while the workers run batch k
+    TraceParser *cpu_trace = initTraceParser(trace_file);
+    uint64_t num_of_instructions = 0;
+
+    shared.batch_len[0] = decodeBatch(&cpu_trace, shared.batches[0], &num_of_instructions);
+    while (shared.batch_len[shared.cur] > 0)
+    {
+        // Release the workers on the current batch
+        pthread_barrier_wait(&shared.barrier);
+
+        unsigned next = 1 - shared.cur;
+        shared.batch_len[next] = decodeBatch(&cpu_trace, shared.batches[next], &num_of_instructions);
+
+        // Wait until every worker is done with the current batch
+        pthread_barrier_wait(&shared.barrier);
+        shared.cur = next;
+    }
+
+    shared.done = true;
+    pthread_barrier_wait(&shared.barrier);
+
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        int p;
+        for (p = 0; p < workers[i].num_predictors; p++)
+        {
+            freeBranchPredictor(workers[i].predictors[p]);
+        }
+        free(workers[i].predictors);
+        free(workers[i].results);
+    }
+    free(workers);
+
+    pthread_barrier_destroy(&shared.barrier);
+    free(shared.batches[0]);
+    free(shared.batches[1]);
+
+    return num_of_instructions;
+}
+
+void printEvalResults(Eval_Result *results, unsigned num_predictors, uint64_t num_of_instructions)
+{
+    printf("%-12s %10s %8s %10s %14s %12s %10s\n", "Predictor", "Table", "History",
+           "Threshold", "Branches", "Accuracy", "MPKI");
+
+    int i;
+    for (i = 0; i < num_predictors; i++)
+    {
+        Eval_Result *result = &(results[i]);
+
+        double accuracy = result->num_of_branches ?
+            100.0 * (result->num_of_branches - result->num_of_incorrect_predictions) / result->num_of_branches : 0;
+        double mpki = num_of_instructions ?
+            1000.0 * result->num_of_incorrect_predictions / num_of_instructions : 0;
+
+        char threshold[16] = "-";
+        if (result->threshold > 0)
+        {
+            snprintf(threshold, sizeof(threshold), "%u", result->threshold);
+        }
+
+        printf("%-12s %10u %8u %10s %14"PRIu64" %11.4f%% %10.4f\n",
+               type_names[result->config.type], result->config.table_size,
+               result->config.history_bits, threshold,
+               result->num_of_branches, accuracy, mpki);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef __EVALUATE_HH__
+#define __EVALUATE_HH__
+
+#include <stdbool.h>
+
+#include "Branch_Predictor.h"
+
+#define EVAL_BATCH_SIZE 65536 // Branches decoded per batch
+
+// Per-predictor result of an evaluation run
+typedef struct Eval_Result
+{
+    Predictor_Config config;
+    unsigned threshold; // Initial training threshold in effect, 0 for non-perceptron types
+
+    uint64_t num_of_branches;
+    uint64_t num_of_incorrect_predictions;
+}Eval_Result;
+
+// Parse "<type>[:<table-size>[:<history-bits>[:<threshold>]]]", where type
+// is one of local, tournament, gshare, perceptron, hashed. Omitted fields
+// keep the defaults of initPredictorConfig().
+bool parsePredictorConfig(const char *spec, Predictor_Config *config);
+
+// Decode the trace once and drive every configured predictor with it.
+// Predictors are split across num_threads workers; each worker owns its
+// predictors and reads the shared branch batches. Returns the number of
+// instructions in the trace.
+uint64_t evaluatePredictors(const char *trace_file, Eval_Result *results,
+                            unsigned num_predictors, unsigned num_threads);
+
+// Print one accuracy / MPKI row per predictor
+void printEvalResults(Eval_Result *results, unsigned num_predictors, uint64_t num_of_instructions);
+
+#endif
@@ -1,25 +1,251 @@
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+
 #include "Trace.h"
 #include "Branch_Predictor.h"
+#include "Snapshot.h"
+#include "Interval.h"
+#include "Evaluate.h"
+#include "Parallel.h"
+#include "Profile.h"
+#include "Branch_Profile.h"
 
 extern TraceParser *initTraceParser(const char * trace_file);
 extern bool getInstruction(TraceParser *cpu_trace);
 
 extern Branch_Predictor *initBranchPredictor();
 extern bool predict(Branch_Predictor *branch_predictor, Instruction *instr);
-int main(int argc, const char *argv[])
-{	
-    if (argc != 2)
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-w <warmup-instructions>] [-s <save-snapshot>] [-l <load-snapshot>]\n"
+           "       [-i <interval-instructions> -o <interval-file>] [-m <top-branches>]\n"
+           "       [-p <predictor> ... [-t <threads>]] [-k <chunks>[:<warmup>] [-V]] %s\n",
+           prog, "<trace-file>");
+    printf("  -w  the first N instructions only warm up the predictor and are not counted;\n");
+    printf("      when a snapshot is loaded they are skipped instead\n");
+    printf("  -s  save the predictor state after the warmup (or at the end of the run)\n");
+    printf("  -l  restore the predictor state from a snapshot before running\n");
+    printf("  -i  emit a statistics record every N instructions to the -o file\n");
+    printf("  -o  interval sink: *.csv or - (stdout) for CSV, anything else is binary\n");
+    printf("  -m  report the N (at most %d) branches with the most mispredictions,\n",
+           BRANCH_PROFILE_MAX_TOP);
+    printf("      tracked in a fixed-size sketch of %d slots per branch reported\n",
+           BRANCH_PROFILE_SLOTS_PER_ROW);
+    printf("  -p  evaluate a predictor, type[:table-size[:history-bits[:threshold]]] with type\n");
+    printf("      local, tournament, gshare, perceptron or hashed (hashed perceptron);\n");
+    printf("      repeat -p to evaluate several\n");
+    printf("      predictors in one pass over the trace\n");
+    printf("  -t  worker threads the -p predictors are split across (default 1)\n");
+    printf("  -k  simulate the trace as up to %u parallel chunks, each warmed on the\n",
+           MAX_CHUNKS);
+    printf("      <warmup> instructions before it (default %d); builds <trace-file>.idx once\n",
+           CHUNK_WARMUP);
+    printf("  -V  with -k, also run the trace serially and report the deviation\n");
+    printf("  <trace-file> may be a live framed stream: - (stdin), unix:<socket-path> or a FIFO\n");
+}
+
+// A decimal count from 0 to max, anything else (signs included) is rejected
+static bool parseCount(const char *arg, unsigned max, unsigned *count)
+{
+    char *end;
+    errno = 0;
+    unsigned long value = strtoul(arg, &end, 10);
+    if (!isdigit((unsigned char)arg[0]) || *end != '\0' || errno != 0 || value > max)
+    {
+        return false;
+    }
+    *count = value;
+    return true;
+}
+
+static const char *interval_fields[] = {"instructions", "branches", "mispredictions",
+                                        "mpki", "accuracy"};
+
+// Statistics of the interval that just ended
+static void emitInterval(Interval_Writer *writer, uint64_t instructions,
+                         uint64_t branches, uint64_t mispredictions, uint64_t interval_len)
+{
+    double fields[5];
+    fields[0] = instructions;
+    fields[1] = branches;
+    fields[2] = mispredictions;
+    fields[3] = (double)mispredictions * 1000 / interval_len;
+    fields[4] = branches ? 1 - (double)mispredictions / branches : 0;
+    pushInterval(writer, fields);
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t warmup = 0;
+    const char *save_file = NULL;
+    const char *load_file = NULL;
+    uint64_t interval_len = 0;
+    const char *interval_file = NULL;
+    Eval_Result *eval_results = (Eval_Result *)malloc(argc * sizeof(Eval_Result));
+    unsigned num_eval = 0;
+    unsigned num_threads = 1;
+    unsigned num_chunks = 0;
+    uint64_t chunk_warmup = CHUNK_WARMUP;
+    bool chunk_verify = false;
+    unsigned top_branches = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:s:l:i:o:m:p:t:k:V")) != -1)
+    {
+        switch (opt)
+        {
+            case 'w': warmup = strtoull(optarg, NULL, 10); break;
+            case 's': save_file = optarg; break;
+            case 'l': load_file = optarg; break;
+            case 'i': interval_len = strtoull(optarg, NULL, 10); break;
+            case 'o': interval_file = optarg; break;
+            case 'm':
+                if (!parseCount(optarg, BRANCH_PROFILE_MAX_TOP, &top_branches) || top_branches == 0)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'p':
+                if (!parsePredictorConfig(optarg, &(eval_results[num_eval++].config)))
+                {
+                    return 1;
+                }
+                break;
+            case 't': num_threads = atoi(optarg); break;
+            case 'k':
+                if (strchr(optarg, ':') != NULL)
+                {
+                    chunk_warmup = strtoull(strchr(optarg, ':') + 1, NULL, 10);
+                    *strchr(optarg, ':') = '\0';
+                }
+                if (!parseCount(optarg, MAX_CHUNKS, &num_chunks) || num_chunks == 0)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'V': chunk_verify = true; break;
+            default: usage(argv[0]); return 0;
+        }
+    }
+
+    if (optind != argc - 1 || (interval_len > 0) != (interval_file != NULL) ||
+        (num_chunks > 0 && (warmup > 0 || save_file || load_file || interval_file || num_eval > 0)) ||
+        (num_eval > 0 && (warmup > 0 || save_file || load_file || interval_file)) ||
+        (top_branches > 0 && (num_chunks > 0 || num_eval > 0)))
+    {
+        usage(argv[0]);
+
+        return 0;
+    }
+    const char *trace_file = argv[optind];
+
+    PROFILE_INIT("Branch_Predictor");
+    PROFILE_BEGIN(PHASE_SETUP);
+
+    // Chunk-parallel run of one predictor over an indexed trace
+    if (num_chunks > 0)
+    {
+        PROFILE_END(PHASE_SETUP);
+        PROFILE_BEGIN(PHASE_RUN);
+        Chunk_Result *chunks = (Chunk_Result *)malloc(num_chunks * sizeof(Chunk_Result));
+        Chunk_Result merged, reference;
+        if (!simulateChunks(trace_file, num_chunks, chunk_warmup, chunks, &merged,
+                            chunk_verify ? &reference : NULL))
+        {
+            return 1;
+        }
+        PROFILE_END(PHASE_RUN);
+
+        PROFILE_BEGIN(PHASE_REPORT);
+        printf("File: %s\n", trace_file);
+        printChunkReport(chunks, num_chunks, &merged, chunk_verify ? &reference : NULL);
+        PROFILE_END(PHASE_REPORT);
+        PROFILE_REPORT();
+
+        return 0;
+    }
+
+    // Design-space evaluation: one trace pass for every -p predictor
+    if (num_eval > 0)
     {
-        printf("Usage: %s %s\n", argv[0], "<trace-file>");
+        PROFILE_END(PHASE_SETUP);
+        PROFILE_BEGIN(PHASE_RUN);
+        uint64_t num_of_instructions = evaluatePredictors(trace_file, eval_results, num_eval, num_threads);
+        PROFILE_END(PHASE_RUN);
+
+        PROFILE_BEGIN(PHASE_REPORT);
+        printf("File: %s\n", trace_file);
+        printf("Number of instructions: %"PRIu64"\n", num_of_instructions);
+        printEvalResults(eval_results, num_eval, num_of_instructions);
+        free(eval_results);
+        PROFILE_END(PHASE_REPORT);
+        PROFILE_REPORT();
 
         return 0;
     }
 
+    Interval_Writer *intervals = NULL;
+    if (interval_file != NULL)
+    {
+        intervals = initIntervalWriter(interval_file, interval_fields, 5);
+        if (intervals == NULL)
+        {
+            return 1;
+        }
+    }
+
     // Initialize a CPU trace parser
-    TraceParser *cpu_trace = initTraceParser(argv[1]);
+    TraceParser *cpu_trace = initTraceParser(trace_file);
+
+    // Initialize a branch predictor, either cold or from a warmed snapshot
+    Branch_Predictor *branch_predictor;
+    if (load_file != NULL)
+    {
+        branch_predictor = loadBranchPredictor(load_file);
+        if (branch_predictor == NULL)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        branch_predictor = initBranchPredictor();
+    }
+
+    // Per-branch profile of the counted instructions
+    Branch_Profile *branch_profile = NULL;
+    if (top_branches > 0)
+    {
+        branch_profile = initBranchProfile(top_branches, branch_predictor);
+    }
+
+    PROFILE_END(PHASE_SETUP);
+
+    // Warming up the predictor (or skipping the region a snapshot already covers)
+    PROFILE_BEGIN(PHASE_WARMUP);
+    uint64_t num_of_warmup = 0;
+    bool more = true;
+    while (num_of_warmup < warmup && (more = getInstruction(cpu_trace)))
+    {
+        if (load_file == NULL && cpu_trace->cur_instr->instr_type == BRANCH)
+        {
+            predict(branch_predictor, cpu_trace->cur_instr);
+        }
+        ++num_of_warmup;
+    }
+    PROFILE_END(PHASE_WARMUP);
 
-    // Initialize a branch predictor
-    Branch_Predictor *branch_predictor = initBranchPredictor();
+    if (save_file != NULL && warmup > 0)
+    {
+        if (!saveBranchPredictor(branch_predictor, save_file))
+        {
+            return 1;
+        }
+    }
 
     // Running the trace
     uint64_t num_of_instructions = 0;
@@ -27,13 +253,22 @@ int main(int argc, const char *argv[])
     uint64_t num_of_correct_predictions = 0;
     uint64_t num_of_incorrect_predictions = 0;
 
-    while (getInstruction(cpu_trace))
+    // Counters at the start of the current interval
+    uint64_t interval_branches = 0;
+    uint64_t interval_incorrect = 0;
+    uint64_t interval_left = interval_len;
+
+    PROFILE_BEGIN(PHASE_RUN);
+    while (more && getInstruction(cpu_trace))
     {
+        PROFILE_STAGE(STAGE_PARSE);
+
         // We are only interested in BRANCH instruction
         if (cpu_trace->cur_instr->instr_type == BRANCH)
         {
             ++num_of_branches;
-            if (predict(branch_predictor, cpu_trace->cur_instr))
+            bool correct = predict(branch_predictor, cpu_trace->cur_instr);
+            if (correct)
             {
                 ++num_of_correct_predictions;
             }
@@ -41,16 +276,66 @@ int main(int argc, const char *argv[])
             {
                 ++num_of_incorrect_predictions;
             }
+
+            if (branch_profile != NULL)
+            {
+                profileBranch(branch_profile, branch_predictor, cpu_trace->cur_instr, correct);
+            }
         }
         ++num_of_instructions;
+
+        if (intervals != NULL && --interval_left == 0)
+        {
+            emitInterval(intervals, num_of_instructions,
+                         num_of_branches - interval_branches,
+                         num_of_incorrect_predictions - interval_incorrect, interval_len);
+            interval_branches = num_of_branches;
+            interval_incorrect = num_of_incorrect_predictions;
+            interval_left = interval_len;
+        }
+
+        PROFILE_STAGE(STAGE_SIMULATE);
+        PROFILE_NEXT_RECORD();
+    }
+
+    PROFILE_END(PHASE_RUN);
+
+    PROFILE_BEGIN(PHASE_REPORT);
+    if (intervals != NULL)
+    {
+        // Partial last interval
+        if (interval_left != interval_len)
+        {
+            emitInterval(intervals, num_of_instructions,
+                         num_of_branches - interval_branches,
+                         num_of_incorrect_predictions - interval_incorrect,
+                         interval_len - interval_left);
+        }
+        closeIntervalWriter(intervals);
+    }
+
+    if (save_file != NULL && warmup == 0)
+    {
+        if (!saveBranchPredictor(branch_predictor, save_file))
+        {
+            return 1;
+        }
     }
 
 //    printf("Number of instructions: %"PRIu64"\n", num_of_instructions);
 //    printf("Number of branches: %"PRIu64"\n", num_of_branches);
-    printf("File: %s\n", argv[1]);
+    printf("File: %s\n", trace_file);
     printf("Number of correct predictions: %"PRIu64"\n", num_of_correct_predictions);
     printf("Number of incorrect predictions: %"PRIu64"\n", num_of_incorrect_predictions);
 
     float performance = (float)num_of_correct_predictions / (float)num_of_branches * 100;
     printf("Predictor Correctness: %f%%\n", performance);
+
+    if (branch_profile != NULL)
+    {
+        printBranchProfile(branch_profile);
+        freeBranchProfile(branch_profile);
+    }
+    PROFILE_END(PHASE_REPORT);
+    PROFILE_REPORT();
 }
@@ -0,0 +1,156 @@
+#include "Parallel.h"
+
+#include <pthread.h>
+
+#include "Trace.h"
+#include "Index.h"
+#include "Branch_Predictor.h"
+
+typedef struct Chunk_Worker
+{
+    const char *trace_file;
+    const Trace_Index *index;
+
+    uint64_t warm_first; // First record the predictor sees
+    Chunk_Result *result;
+    bool ok;
+
+    pthread_t thread;
+}Chunk_Worker;
+
+static void *simulateChunk(void *arg)
+{
+    Chunk_Worker *worker = (Chunk_Worker *)arg;
+    Chunk_Result *result = worker->result;
+
+    TraceParser *cpu_trace = initTraceParser(worker->trace_file);
+    if (!seekTraceParser(cpu_trace, worker->index, worker->warm_first))
+    {
+        closeTraceParser(cpu_trace);
+        return NULL;
+    }
+
+    Branch_Predictor *branch_predictor = initBranchPredictor();
+
+    uint64_t record;
+    for (record = worker->warm_first; record < result->last; record++)
+    {
+        if (!getInstruction(cpu_trace))
+        {
+            // Trace shorter than its index, the parser is already released
+            freeBranchPredictor(branch_predictor);
+            return NULL;
+        }
+
+        if (cpu_trace->cur_instr->instr_type == BRANCH)
+        {
+            bool correct = predict(branch_predictor, cpu_trace->cur_instr);
+            if (record >= result->first)
+            {
+                ++result->num_of_branches;
+                result->num_of_incorrect_predictions += !correct;
+            }
+        }
+    }
+    closeTraceParser(cpu_trace);
+    freeBranchPredictor(branch_predictor);
+
+    worker->ok = true;
+    return NULL;
+}
+
+bool simulateChunks(const char *trace_file, unsigned num_chunks, uint64_t warmup,
+                    Chunk_Result *chunks, Chunk_Result *merged, Chunk_Result *reference)
+{
+    Trace_Index *index = loadTraceIndex(trace_file);
+    if (index == NULL)
+    {
+        return false;
+    }
+
+    unsigned num_workers = num_chunks + (reference != NULL);
+    Chunk_Worker *workers = (Chunk_Worker *)calloc(num_workers, sizeof(Chunk_Worker));
+
+    int i;
+    for (i = 0; i < num_workers; i++)
+    {
+        Chunk_Result *result = i < num_chunks ? &chunks[i] : reference;
+        memset(result, 0, sizeof(Chunk_Result));
+
+        if (i < num_chunks)
+        {
+            result->first = index->num_records * i / num_chunks;
+            result->last = index->num_records * (i + 1) / num_chunks;
+        }
+        else
+        {
+            result->first = 0;
+            result->last = index->num_records;
+        }
+
+        workers[i].trace_file = trace_file;
+        workers[i].index = index;
+        workers[i].warm_first = result->first > warmup ? result->first - warmup : 0;
+        workers[i].result = result;
+        pthread_create(&workers[i].thread, NULL, simulateChunk, &workers[i]);
+    }
+
+    bool ok = true;
+    memset(merged, 0, sizeof(Chunk_Result));
+    merged->last = index->num_records;
+    for (i = 0; i < num_workers; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        ok = ok && workers[i].ok;
+
+        if (i < num_chunks)
+        {
+            merged->num_of_branches += chunks[i].num_of_branches;
+            merged->num_of_incorrect_predictions += chunks[i].num_of_incorrect_predictions;
+        }
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "%s: trace changed under its index\n", trace_file);
+    }
+
+    free(workers);
+    freeTraceIndex(index);
+
+    return ok;
+}
+
+static double accuracy(Chunk_Result *result)
+{
+    return result->num_of_branches ?
+           100.0 * (result->num_of_branches - result->num_of_incorrect_predictions) /
+           result->num_of_branches : 0;
+}
+
+void printChunkReport(Chunk_Result *chunks, unsigned num_chunks,
+                      Chunk_Result *merged, Chunk_Result *reference)
+{
+    printf("%-6s %14s %14s %12s %12s\n", "Chunk", "First", "Last", "Branches", "Accuracy");
+
+    int i;
+    for (i = 0; i < num_chunks; i++)
+    {
+        printf("%-6d %14"PRIu64" %14"PRIu64" %12"PRIu64" %11.4f%%\n", i, chunks[i].first,
+               chunks[i].last, chunks[i].num_of_branches, accuracy(&chunks[i]));
+    }
+
+    printf("Number of incorrect predictions: %"PRIu64"\n", merged->num_of_incorrect_predictions);
+    printf("Predictor Correctness: %f%%\n", accuracy(merged));
+
+    if (reference != NULL)
+    {
+        int64_t delta = (int64_t)merged->num_of_incorrect_predictions -
+                        (int64_t)reference->num_of_incorrect_predictions;
+
+        printf("Serial Correctness: %f%%\n", accuracy(reference));
+        printf("Deviation: %+"PRId64" incorrect predictions (%+.2f%%), %+f accuracy points\n",
+               delta, reference->num_of_incorrect_predictions ?
+               100.0 * delta / reference->num_of_incorrect_predictions : 0,
+               accuracy(merged) - accuracy(reference));
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef __PARALLEL_HH__
+#define __PARALLEL_HH__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CHUNK_WARMUP 100000 // Default instructions a chunk warms up on
+#define MAX_CHUNKS 1024 // One thread each
+
+// Statistics over records [first, last) of the trace
+typedef struct Chunk_Result
+{
+    uint64_t first;
+    uint64_t last;
+
+    uint64_t num_of_branches;
+    uint64_t num_of_incorrect_predictions;
+}Chunk_Result;
+
+// Split the trace (through its sidecar index, see Index.h) into num_chunks
+// contiguous chunks and simulate them concurrently, one thread and one
+// private predictor per chunk. Each predictor is first warmed, uncounted,
+// on the warmup instructions before its chunk. chunks[] receives the
+// per-chunk statistics and merged their sum. If reference is not NULL, one
+// more thread runs the whole trace serially into it. Returns false if the
+// trace cannot be indexed.
+bool simulateChunks(const char *trace_file, unsigned num_chunks, uint64_t warmup,
+                    Chunk_Result *chunks, Chunk_Result *merged, Chunk_Result *reference);
+
+// Per-chunk table and the merged result, with its deviation from the
+// serial reference when there is one
+void printChunkReport(Chunk_Result *chunks, unsigned num_chunks,
+                      Chunk_Result *merged, Chunk_Result *reference);
+
+#endif
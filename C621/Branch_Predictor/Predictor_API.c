@@ -0,0 +1,126 @@
+#include "Predictor_API.h"
+
+#include "Instruction.h"
+#include "Branch_Predictor.h"
+
+struct Predictor_Sim
+{
+    Branch_Predictor *branch_predictor;
+
+    uint64_t num_of_instructions;
+    uint64_t num_of_branches;
+    uint64_t num_of_incorrect_predictions;
+};
+
+// Predictor_Sim_Type and Predictor_Instr_Type list their values in the
+// order of Predictor_Type and Instruction_Type
+static void toPredictorSimConfig(Predictor_Sim_Config *sim_config, const Predictor_Config *config)
+{
+    sim_config->type = (Predictor_Sim_Type)config->type;
+    sim_config->table_size = config->table_size;
+    sim_config->history_bits = config->history_bits;
+    sim_config->threshold = config->threshold;
+    sim_config->counter_bits = config->counter_bits;
+    sim_config->local_size = config->local_size;
+    sim_config->num_tables = config->num_tables;
+}
+
+static void fromPredictorSimConfig(Predictor_Config *config, const Predictor_Sim_Config *sim_config)
+{
+    config->type = (Predictor_Type)sim_config->type;
+    config->table_size = sim_config->table_size;
+    config->history_bits = sim_config->history_bits;
+    config->threshold = sim_config->threshold;
+    config->counter_bits = sim_config->counter_bits;
+    config->local_size = sim_config->local_size;
+    config->num_tables = sim_config->num_tables;
+}
+
+void initPredictorSimConfig(Predictor_Sim_Config *sim_config, Predictor_Sim_Type type)
+{
+    Predictor_Config config;
+    initPredictorConfig(&config, (Predictor_Type)type);
+    toPredictorSimConfig(sim_config, &config);
+}
+
+Predictor_Sim *createPredictorSim(const Predictor_Sim_Config *sim_config)
+{
+    Predictor_Config config;
+    if (sim_config == NULL)
+    {
+        initPredictorConfig(&config, PERCEPTRON);
+    }
+    else
+    {
+        fromPredictorSimConfig(&config, sim_config);
+    }
+
+    if (!checkPredictorConfig(&config))
+    {
+        return NULL;
+    }
+
+    Predictor_Sim *sim = (Predictor_Sim *)calloc(1, sizeof(Predictor_Sim));
+    sim->branch_predictor = initBranchPredictorConfig(&config);
+
+    return sim;
+}
+
+bool pushInstruction(Predictor_Sim *sim, const Predictor_Instr *sim_instr)
+{
+    ++sim->num_of_instructions;
+
+    if (sim_instr->instr_type != PREDICTOR_BRANCH)
+    {
+        return true;
+    }
+
+    Instruction instr;
+    instr.PC = sim_instr->PC;
+    instr.instr_type = BRANCH;
+    instr.load_or_store_addr = sim_instr->load_or_store_addr;
+    instr.size = sim_instr->size;
+    instr.taken = sim_instr->taken;
+
+    ++sim->num_of_branches;
+    if (!predict(sim->branch_predictor, &instr))
+    {
+        ++sim->num_of_incorrect_predictions;
+        return false;
+    }
+    return true;
+}
+
+void pushInstructions(Predictor_Sim *sim, const Predictor_Instr *instrs, size_t num_instrs)
+{
+    size_t i;
+    for (i = 0; i < num_instrs; i++)
+    {
+        pushInstruction(sim, &instrs[i]);
+    }
+}
+
+void getPredictorStats(const Predictor_Sim *sim, Predictor_Stats *stats)
+{
+    stats->num_of_instructions = sim->num_of_instructions;
+    stats->num_of_branches = sim->num_of_branches;
+    stats->num_of_incorrect_predictions = sim->num_of_incorrect_predictions;
+
+    stats->accuracy = sim->num_of_branches ?
+                      1 - (double)sim->num_of_incorrect_predictions / sim->num_of_branches : 0;
+    stats->mpki = sim->num_of_instructions ?
+                  1000.0 * sim->num_of_incorrect_predictions / sim->num_of_instructions : 0;
+}
+
+void resetPredictorStats(Predictor_Sim *sim)
+{
+    sim->num_of_instructions = 0;
+    sim->num_of_branches = 0;
+    sim->num_of_incorrect_predictions = 0;
+}
+
+void destroyPredictorSim(Predictor_Sim *sim)
+{
+    freeBranchPredictor(sim->branch_predictor);
+    free(sim);
+}
@@ -0,0 +1,81 @@
+#ifndef __PREDICTOR_API_HH__
+#define __PREDICTOR_API_HH__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// In-process predictor simulation, built as libpredictor.a / libpredictor.so
+// ("make lib"). Instances share no state, so any number can run side by
+// side, including on different threads (one thread per instance).
+//
+// Only the functions below are exported from the shared library; the
+// simulator handle is opaque. The header stands alone, every type it
+// declares is prefixed, so it can share a translation unit with Cache_API.h.
+// PREDICTOR_API_VERSION changes whenever a signature or a struct below does.
+#define PREDICTOR_API_VERSION 2
+
+#define PREDICTOR_API __attribute__((visibility("default")))
+
+typedef struct Predictor_Sim Predictor_Sim;
+
+typedef enum Predictor_Sim_Type{PREDICTOR_TWO_BIT_LOCAL, PREDICTOR_TOURNAMENT, PREDICTOR_GSHARE,
+                                PREDICTOR_PERCEPTRON, PREDICTOR_HASHED_PERCEPTRON}Predictor_Sim_Type;
+
+typedef struct Predictor_Sim_Config
+{
+    Predictor_Sim_Type type;
+
+    unsigned table_size; // Entries of the main table (local, global, perceptron or each hashed table)
+    unsigned history_bits; // (Longest) global history length, 0 for the default
+    unsigned threshold; // (Initial) perceptron training threshold, 0 for the default
+
+    unsigned counter_bits; // Width of the two-bit local, gshare and tournament global counters
+    unsigned local_size; // Tournament local counter and history tables
+    unsigned num_tables; // Hashed perceptron weight tables, 3 to 16
+}Predictor_Sim_Config;
+
+typedef enum Predictor_Instr_Type{PREDICTOR_EXE, PREDICTOR_BRANCH, PREDICTOR_LOAD,
+                                  PREDICTOR_STORE}Predictor_Instr_Type;
+
+typedef struct Predictor_Instr
+{
+    uint64_t PC;
+    Predictor_Instr_Type instr_type;
+    uint64_t load_or_store_addr; // LOAD and STORE only
+    int size; // Bytes loaded or stored
+    int taken; // Real direction of a branch
+}Predictor_Instr;
+
+typedef struct Predictor_Stats
+{
+    uint64_t num_of_instructions;
+    uint64_t num_of_branches;
+    uint64_t num_of_incorrect_predictions;
+
+    double accuracy; // Correct predictions over branches, 0 with no branches
+    double mpki;     // Mispredictions per 1000 instructions
+}Predictor_Stats;
+
+// Fill config with the defaults of a predictor type, then adjust any field
+PREDICTOR_API void initPredictorSimConfig(Predictor_Sim_Config *config, Predictor_Sim_Type type);
+
+// A fresh predictor, the default perceptron when config is NULL.
+// Returns NULL for an invalid configuration.
+PREDICTOR_API Predictor_Sim *createPredictorSim(const Predictor_Sim_Config *config);
+
+// Simulate one instruction (only branches reach the predictor). Returns
+// false for a mispredicted branch.
+PREDICTOR_API bool pushInstruction(Predictor_Sim *sim, const Predictor_Instr *instr);
+
+// Simulate num_instrs instructions from a buffer, in order
+PREDICTOR_API void pushInstructions(Predictor_Sim *sim, const Predictor_Instr *instrs, size_t num_instrs);
+
+PREDICTOR_API void getPredictorStats(const Predictor_Sim *sim, Predictor_Stats *stats);
+
+// Zero the statistics but keep the trained state, e.g. after a warmup
+PREDICTOR_API void resetPredictorStats(Predictor_Sim *sim);
+
+PREDICTOR_API void destroyPredictorSim(Predictor_Sim *sim);
+
+#endif
@@ -0,0 +1,52 @@
+#include <unistd.h>
+
+#include "Trace.h"
+
+// Stand-in for a live tracer: replays a text CPU trace as a framed stream
+int main(int argc, const char *argv[])
+{
+    if (argc != 2 && argc != 3)
+    {
+        printf("Usage: %s %s\n", argv[0], "<trace-file> [- | unix:<path> | <fifo>]");
+
+        return 0;
+    }
+
+    int sink = openStreamSink(argc == 3 ? argv[2] : "-");
+    if (sink < 0 || !writeStreamHeader(sink, CPU_STREAM_MAGIC))
+    {
+        return 1;
+    }
+
+    TraceParser *cpu_trace = initTraceParser(argv[1]);
+
+    Instruction_Record *records = (Instruction_Record *)calloc(STREAM_FRAME_RECORDS, sizeof(Instruction_Record));
+    uint32_t count = 0;
+    bool ok = true;
+
+    while (ok && getInstruction(cpu_trace))
+    {
+        Instruction *instr = cpu_trace->cur_instr;
+
+        records[count].PC = instr->PC;
+        records[count].load_or_store_addr = instr->load_or_store_addr;
+        records[count].size = instr->size;
+        records[count].instr_type = instr->instr_type;
+        records[count].taken = instr->taken;
+
+        if (++count == STREAM_FRAME_RECORDS)
+        {
+            ok = writeStreamFrame(sink, records, count, sizeof(Instruction_Record));
+            count = 0;
+        }
+    }
+
+    // Last partial frame and the end-of-stream frame
+    ok = ok && (count == 0 || writeStreamFrame(sink, records, count, sizeof(Instruction_Record)));
+    ok = ok && writeStreamFrame(sink, records, 0, sizeof(Instruction_Record));
+
+    free(records);
+    close(sink);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include "Snapshot.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool saveBranchPredictor(Branch_Predictor *branch_predictor, const char *snapshot_file)
+{
+    if (branch_predictor->type != PERCEPTRON)
+    {
+        fprintf(stderr, "%s: snapshots are only supported for the perceptron predictor\n",
+                snapshot_file);
+        return false;
+    }
+
+    FILE *fd = fopen(snapshot_file, "wb");
+    if (fd == NULL)
+    {
+        perror(snapshot_file);
+        return false;
+    }
+
+    unsigned num_weights = branch_predictor->perceptron[0].num_perceptron + 1;
+
+    Predictor_Snapshot_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PREDICTOR_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.global_predictor_size = branch_predictor->global_predictor_size;
+    header.global_history_mask = branch_predictor->global_history_mask;
+    header.perceptron_size = branch_predictor->perceptron_size;
+    header.perceptron_mask = branch_predictor->perceptron_mask;
+    header.threshold = branch_predictor->threshold;
+    header.num_weights = num_weights;
+    header.global_history = branch_predictor->global_history;
+
+    bool ok = fwrite(&header, sizeof(header), 1, fd) == 1;
+
+    ok = ok && fwrite(branch_predictor->global_counters, sizeof(Sat_Counter),
+                      header.global_predictor_size, fd) == header.global_predictor_size;
+
+    // Weight vectors are separate allocations, flatten them into one array
+    int i;
+    for (i = 0; ok && i < header.perceptron_size; i++)
+    {
+        ok = fwrite(branch_predictor->perceptron[i].weight, sizeof(int64_t),
+                    num_weights, fd) == num_weights;
+    }
+
+    if (fclose(fd) != 0 || !ok)
+    {
+        fprintf(stderr, "%s: failed to write snapshot\n", snapshot_file);
+        return false;
+    }
+
+    return true;
+}
+
+Branch_Predictor *loadBranchPredictor(const char *snapshot_file)
+{
+    int fd = open(snapshot_file, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(snapshot_file);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < sizeof(Predictor_Snapshot_Header))
+    {
+        fprintf(stderr, "%s: not a predictor snapshot\n", snapshot_file);
+        close(fd);
+        return NULL;
+    }
+
+    // Private mapping: pages are only copied once training modifies them
+    char *base = (char *)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror(snapshot_file);
+        return NULL;
+    }
+
+    Predictor_Snapshot_Header *header = (Predictor_Snapshot_Header *)base;
+
+    // The geometry must be one initBranchPredictorConfig() builds, with 1 to
+    // 64 history bits, which also keeps the lengths below from overflowing
+    if (memcmp(header->magic, PREDICTOR_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        !checkPowerofTwo(header->perceptron_size) ||
+        header->global_predictor_size != header->perceptron_size ||
+        header->global_history_mask != header->global_predictor_size - 1 ||
+        header->perceptron_mask != header->perceptron_size - 1 ||
+        header->num_weights < 2 || header->num_weights > 65)
+    {
+        fprintf(stderr, "%s: not a predictor snapshot\n", snapshot_file);
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    size_t counters_len = (size_t)header->global_predictor_size * sizeof(Sat_Counter);
+    size_t weights_len = (size_t)header->perceptron_size * header->num_weights * sizeof(int64_t);
+
+    if (st.st_size != sizeof(*header) + counters_len + weights_len)
+    {
+        fprintf(stderr, "%s: not a predictor snapshot\n", snapshot_file);
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    // Every counter feeds its perceptron one history bit per weight but the bias
+    Sat_Counter *counters = (Sat_Counter *)(base + sizeof(*header));
+    unsigned j;
+    for (j = 0; j < header->global_predictor_size; j++)
+    {
+        if (counters[j].counter_bits != header->num_weights - 1)
+        {
+            fprintf(stderr, "%s: corrupt counter %u\n", snapshot_file, j);
+            munmap(base, st.st_size);
+            return NULL;
+        }
+    }
+
+    Branch_Predictor *branch_predictor = (Branch_Predictor *)malloc(sizeof(Branch_Predictor));
+    memset(branch_predictor, 0, sizeof(Branch_Predictor));
+
+    branch_predictor->type = PERCEPTRON;
+
+    branch_predictor->global_predictor_size = header->global_predictor_size;
+    branch_predictor->global_history_mask = header->global_history_mask;
+    branch_predictor->global_history = header->global_history;
+    branch_predictor->perceptron_size = header->perceptron_size;
+    branch_predictor->perceptron_mask = header->perceptron_mask;
+    branch_predictor->threshold = header->threshold;
+
+    branch_predictor->global_counters = counters;
+
+    int64_t *weights = (int64_t *)(base + sizeof(*header) + counters_len);
+
+    branch_predictor->perceptron = (Perceptron *)malloc(header->perceptron_size * sizeof(Perceptron));
+    int i;
+    for (i = 0; i < header->perceptron_size; i++)
+    {
+        branch_predictor->perceptron[i].weight = weights + (size_t)i * header->num_weights;
+        branch_predictor->perceptron[i].num_perceptron = header->num_weights - 1;
+    }
+
+    branch_predictor->snapshot_base = base;
+    branch_predictor->snapshot_len = st.st_size;
+
+    return branch_predictor;
+}
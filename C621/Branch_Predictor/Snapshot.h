@@ -0,0 +1,37 @@
+#ifndef __SNAPSHOT_HH__
+#define __SNAPSHOT_HH__
+
+#include <stdbool.h>
+
+#include "Branch_Predictor.h"
+
+#define PREDICTOR_SNAPSHOT_MAGIC "BPSNAP01"
+
+// On-disk layout:
+//   Predictor_Snapshot_Header
+//   Sat_Counter global_counters[global_predictor_size]
+//   int64_t     weights[perceptron_size][num_weights]
+// Every section starts on an 8-byte boundary so the file can be mapped
+// and used in place.
+typedef struct Predictor_Snapshot_Header
+{
+    char magic[8];
+
+    uint32_t global_predictor_size;
+    uint32_t global_history_mask;
+    uint32_t perceptron_size;
+    uint32_t perceptron_mask;
+    uint32_t threshold;
+    uint32_t num_weights; // history bits + 1 (bias)
+
+    uint64_t global_history;
+}Predictor_Snapshot_Header;
+
+// Write the full predictor state to a snapshot file (perceptron only)
+bool saveBranchPredictor(Branch_Predictor *branch_predictor, const char *snapshot_file);
+
+// Map a snapshot file and return a predictor that uses it in place.
+// The mapping is private, so training never writes back to the file.
+Branch_Predictor *loadBranchPredictor(const char *snapshot_file);
+
+#endif
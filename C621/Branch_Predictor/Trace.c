@@ -4,7 +4,27 @@ TraceParser *initTraceParser(const char * trace_file)
 {
     TraceParser *trace_parser = (TraceParser *)malloc(sizeof(TraceParser));
 
-    trace_parser->fd = fopen(trace_file, "r");
+    trace_parser->fd = NULL;
+    trace_parser->stream = NULL;
+
+    int stream_fd = openStreamSource(trace_file);
+    if (stream_fd >= 0)
+    {
+        trace_parser->stream = initStreamReader(stream_fd, CPU_STREAM_MAGIC, sizeof(Instruction_Record));
+        if (trace_parser->stream == NULL)
+        {
+            exit(1);
+        }
+    }
+    else
+    {
+        trace_parser->fd = fopen(trace_file, "r");
+        if (trace_parser->fd == NULL)
+        {
+            perror(trace_file);
+            exit(1);
+        }
+    }
     trace_parser->cur_instr = (Instruction *)malloc(sizeof(Instruction));
 
     return trace_parser;
@@ -12,6 +32,27 @@ TraceParser *initTraceParser(const char * trace_file)
 
 bool getInstruction(TraceParser *cpu_trace)
 {
+    if (cpu_trace->stream != NULL)
+    {
+        const Instruction_Record *record = (const Instruction_Record *)nextStreamRecord(cpu_trace->stream);
+
+        if (record != NULL)
+        {
+            cpu_trace->cur_instr->PC = record->PC;
+            cpu_trace->cur_instr->instr_type = (Instruction_Type)record->instr_type;
+            cpu_trace->cur_instr->load_or_store_addr = record->load_or_store_addr;
+            cpu_trace->cur_instr->size = record->size;
+            cpu_trace->cur_instr->taken = record->taken;
+            return true;
+        }
+
+        // Release memory
+        closeStreamReader(cpu_trace->stream);
+        free(cpu_trace->cur_instr);
+        free(cpu_trace);
+        return false;
+    }
+
     char *line = NULL;
     size_t len = 0;
     ssize_t read;
@@ -19,13 +60,14 @@ bool getInstruction(TraceParser *cpu_trace)
     if ((read = getline(&line, &len, cpu_trace->fd)) != -1)
     {
 	char delim[] = " \n";
+	char *save; // strtok_r, so chunk workers can parse concurrently
 
         // This is the PC
-	char *ptr = strtok(line, delim);
+	char *ptr = strtok_r(line, delim, &save);
 	cpu_trace->cur_instr->PC = convToUint64(ptr);
 
         // This is the instruction type
-        ptr = strtok(NULL, delim);
+        ptr = strtok_r(NULL, delim, &save);
         if (strcmp(ptr, "B") == 0)
 	{
             cpu_trace->cur_instr->instr_type = BRANCH;
@@ -46,18 +88,18 @@ bool getInstruction(TraceParser *cpu_trace)
         // More info
         if (strcmp(ptr, "B") == 0)
         {
-            ptr = strtok(NULL, delim);
+            ptr = strtok_r(NULL, delim, &save);
 
             cpu_trace->cur_instr->taken = atoi(ptr);
         }
 
         if (strcmp(ptr, "L") == 0 || strcmp(ptr, "S") == 0)
         {
-            ptr = strtok(NULL, delim);
+            ptr = strtok_r(NULL, delim, &save);
             
             cpu_trace->cur_instr->load_or_store_addr = convToUint64(ptr);
 
-            ptr = strtok(NULL, delim);
+            ptr = strtok_r(NULL, delim, &save);
             
             cpu_trace->cur_instr->size = atoi(ptr);
         }
@@ -77,6 +119,14 @@ bool getInstruction(TraceParser *cpu_trace)
     return false;
 }
 
+// Release a file parser that stops before the end of the trace
+void closeTraceParser(TraceParser *cpu_trace)
+{
+    fclose(cpu_trace->fd);
+    free(cpu_trace->cur_instr);
+    free(cpu_trace);
+}
+
 // convert a string to a uint64_t number
 uint64_t convToUint64(char *ptr)
 {
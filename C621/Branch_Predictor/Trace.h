@@ -7,17 +7,36 @@
 #include <string.h>
 
 #include "Instruction.h"
+#include "Stream.h"
+
+#define CPU_STREAM_MAGIC "CPUSTRM1"
+
+// Instruction as framed on a live stream (see Stream.h)
+typedef struct Instruction_Record
+{
+    uint64_t PC;
+    uint64_t load_or_store_addr;
+    int32_t size;
+    uint8_t instr_type;
+    uint8_t taken;
+    uint8_t pad[2];
+}Instruction_Record;
 
 typedef struct TraceParser
 {
     FILE *fd; // file descriptor for the trace file
 
+    Stream_Reader *stream; // live input instead of a trace file, NULL if none
+
     Instruction *cur_instr; // current instruction
 }TraceParser;
 
 // Define functions
+// trace_file is a text trace, or a live framed stream: "-" (stdin),
+// "unix:<path>" or a FIFO
 TraceParser *initTraceParser(const char * trace_file);
 bool getInstruction(TraceParser *cpu_trace);
+void closeTraceParser(TraceParser *cpu_trace);
 uint64_t convToUint64(char *ptr);
 void printInstruction(Instruction *instr);
 
@@ -1,5 +1,10 @@
 #include "Cache.h"
 
+#include <sys/mman.h>
+
+#include "DRAM.h"
+#include "Coherence.h"
+
 /* Constants */
 const unsigned block_size = 64; // Size of a cache line (in Bytes)
 // TODO, you should try different size of cache, for example, 128KB, 256KB, 512KB, 1MB, 2MB
@@ -7,11 +12,127 @@ const unsigned cache_size = 128; // Size of a cache (in KB)
 // TODO, you should try different association configurations, for example 4, 8, 16
 const unsigned assoc = 4;
 
-const unsigned signature_size = 64;
-
-const unsigned shct_sat = 31;
+#if defined(LRU)
+const Replacement_Policy default_policy = POLICY_LRU;
+#elif defined(LFU)
+const Replacement_Policy default_policy = POLICY_LFU;
+#elif defined(SRRIP)
+const Replacement_Policy default_policy = POLICY_SRRIP;
+#elif defined(BRRIP)
+const Replacement_Policy default_policy = POLICY_BRRIP;
+#elif defined(DRRIP)
+const Replacement_Policy default_policy = POLICY_DRRIP;
+#else
+const Replacement_Policy default_policy = POLICY_SHIP;
+#endif
+
+// Write handling
+const Write_Policy write_policy = WRITE_BACK;
+const Allocate_Policy allocate_policy = WRITE_ALLOCATE;
+const unsigned write_buffer_depth = 8; // Entries, 0 for no write buffer
+
+static const char *policy_names[] = {"lru", "lfu", "srrip", "brrip", "drrip", "ship"};
+static const char *write_policy_names[] = {"wb", "wt"};
+
+// SHiP signature, a hash of the PC into SHCT_ENTRIES
+static inline uint64_t getSignature(uint64_t PC)
+{
+    return (PC ^ (PC >> 14) ^ (PC >> 28)) & (SHCT_ENTRIES - 1);
+}
 
 Cache *initCache()
+{
+    return initCacheGeometry(block_size, cache_size, assoc);
+}
+
+// Default configuration, from the settings above
+void initCacheConfig(Cache_Config *config)
+{
+    config->block_size = block_size;
+    config->cache_size = cache_size;
+    config->assoc = assoc;
+    config->policy = default_policy;
+    config->write_policy = write_policy;
+    config->allocate_policy = allocate_policy;
+    config->write_buffer_depth = write_buffer_depth;
+}
+
+static bool isPowerOfTwo(uint64_t x)
+{
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+bool checkCacheConfig(const Cache_Config *config)
+{
+    if (config->policy > POLICY_SHIP || config->write_policy > WRITE_THROUGH ||
+        config->allocate_policy > NO_WRITE_ALLOCATE ||
+        config->write_buffer_depth > WRITE_BUFFER_MAX_DEPTH ||
+        !isPowerOfTwo(config->block_size) || config->assoc == 0)
+    {
+        return false;
+    }
+
+    uint64_t bytes = (uint64_t)config->cache_size * 1024;
+    uint64_t set_bytes = (uint64_t)config->block_size * config->assoc;
+
+    return bytes % set_bytes == 0 && isPowerOfTwo(bytes / set_bytes);
+}
+
+Cache *initCacheFromConfig(const Cache_Config *config)
+{
+    Cache *cache = initCacheGeometry(config->block_size, config->cache_size, config->assoc);
+    cache->policy = config->policy;
+    configureWrites(cache, config->write_policy, config->allocate_policy,
+                    config->write_buffer_depth);
+
+    return cache;
+}
+
+// Replaces the write handling, an existing write buffer is dropped
+void configureWrites(Cache *cache, Write_Policy write_policy, Allocate_Policy allocate_policy,
+                     unsigned write_buffer_depth)
+{
+    cache->write_policy = write_policy;
+    cache->allocate_policy = allocate_policy;
+
+    free(cache->write_buffer);
+    cache->write_buffer = (Write_Buffer_Entry *)calloc(write_buffer_depth + 1, sizeof(Write_Buffer_Entry));
+    cache->write_buffer_depth = write_buffer_depth;
+    cache->write_buffer_head = 0;
+    cache->write_buffer_count = 0;
+}
+
+void freeCache(Cache *cache)
+{
+    int i;
+    for (i = 0; i < cache->num_sets; i++)
+    {
+        free(cache->sets[i].ways);
+    }
+    free(cache->sets);
+    free(cache->shct);
+    free(cache->write_buffer);
+    if (cache->tag_index != NULL)
+    {
+        freeTagIndex(cache->tag_index);
+    }
+
+    // A restored snapshot maps the blocks and RRPVs in place
+    if (cache->snapshot_base != NULL)
+    {
+        munmap(cache->snapshot_base, cache->snapshot_len);
+    }
+    else
+    {
+        free(cache->blocks);
+        free(cache->rrpv);
+    }
+
+    free(cache);
+}
+
+// The parameters shadow the default geometry above
+Cache *initCacheGeometry(unsigned block_size, unsigned cache_size, unsigned assoc)
 {
     Cache *cache = (Cache *)malloc(sizeof(Cache));
     
@@ -23,6 +144,17 @@ Cache *initCache()
 
     // Initialize all cache blocks
     cache->blocks = (Cache_Block *)malloc(num_blocks * sizeof(Cache_Block));
+    cache->snapshot_base = NULL;
+    cache->snapshot_len = 0;
+    cache->num_writebacks = 0;
+    cache->read_bytes = 0;
+    cache->write_bytes = 0;
+    cache->num_writes = 0;
+    cache->num_coalesced = 0;
+    cache->dram = NULL;
+    cache->now = 0;
+    cache->coherence = NULL;
+    cache->core = 0;
     
     int i;
     for (i = 0; i < num_blocks; i++)
@@ -30,6 +162,7 @@ Cache *initCache()
         cache->blocks[i].tag = UINTMAX_MAX; 
         cache->blocks[i].valid = false;
         cache->blocks[i].dirty = false;
+        cache->blocks[i].exclusive = false;
         cache->blocks[i].when_touched = 0;
         cache->blocks[i].frequency = 0;
         cache->blocks[i].outcome = false;
@@ -38,6 +171,9 @@ Cache *initCache()
 
     // Initialize Set-way variables
     unsigned num_sets = cache_size * 1024 / (block_size * assoc);
+    // Set index and tag are extracted with shifts and masks
+    assert(num_sets > 0 && (num_sets & (num_sets - 1)) == 0);
+    assert((block_size & (block_size - 1)) == 0);
     cache->num_sets = num_sets;
     cache->num_ways = assoc;
 //    printf("Num of sets: %u\n", cache->num_sets);
@@ -74,21 +210,58 @@ Cache *initCache()
 
         cache->sets[set].ways[way] = blk;
     }
-    
-    // add signature_size 1s followed by 0s to fill mask
-    cache->sig_mask = (((uint64_t)pow(2,signature_size))-1) << (64-signature_size);
-    if (signature_size > 49)
+
+    // Use a geometry-specialized lookup engine if one was built for this shape
+    cache->engine = findCacheEngine(block_size, num_sets, assoc);
+
+    cache->policy = default_policy;
+
+    // RRIP state, every block starts at distant re-reference
+    cache->tag_index = NULL;
+    cache->rrpv_words = (assoc * RRPV_BITS + 63) / 64;
+    cache->rrpv = (uint64_t *)malloc((size_t)num_sets * cache->rrpv_words * sizeof(uint64_t));
+    for (i = 0; i < num_sets; i++)
+    {
+        uint32_t way;
+        for (way = 0; way < assoc; way++)
+        {
+            setRRPV(cache, i, way, RRPV_MAX);
+        }
+    }
+
+    // Sets too wide to scan get a tag hash and victim heaps instead
+    if (assoc >= TAG_INDEX_MIN_WAYS)
+    {
+        cache->tag_index = initTagIndex(cache);
+    }
+
+    cache->psel = PSEL_MAX / 2;
+    cache->duel_constituency = num_sets / DUEL_LEADER_SETS;
+    if (cache->duel_constituency < 2)
     {
-        // if signature size is 50 or more, add 32 1s instead
-        cache->sig_mask = ((((uint64_t)pow(2,32)))-1) << (64-signature_size);
+        cache->duel_constituency = 2;
     }
+    cache->brrip_count = 0;
+
+    cache->shct = (uint8_t *)calloc(SHCT_ENTRIES, sizeof(uint8_t));
+
+    // Write buffer mask bits cover whole chunks once a block exceeds 64B
+    cache->chunk_shift = block_size > 64 ? log2(block_size / 64) : 0;
+    cache->write_buffer = NULL;
+    configureWrites(cache, write_policy, allocate_policy, write_buffer_depth);
 
     return cache;
 }
 
+static inline unsigned storeBytes(Request *req)
+{
+    return req->size > 0 ? req->size : STORE_BYTES;
+}
+
 bool accessBlock(Cache *cache, Request *req, uint64_t access_time)
 {
     bool hit = false;
+    cache->now = access_time;
 
     uint64_t blk_aligned_addr = blkAlign(req->load_or_store_addr, cache->blk_mask);
 
@@ -102,15 +275,40 @@ bool accessBlock(Cache *cache, Request *req, uint64_t access_time)
         blk->when_touched = access_time;
         // Increment frequency counter
         ++blk->frequency;
+        if (cache->tag_index != NULL)
+        {
+            touchIndexedBlock(cache, blk);
+        }
 
         if (req->req_type == STORE)
         {
-            blk->dirty = true;
+            // Writing an S copy first invalidates the other copies
+            if (cache->coherence != NULL && !blk->exclusive)
+            {
+                coherenceUpgrade(cache->coherence, cache->core, req);
+                blk->exclusive = true;
+            }
+
+            if (cache->write_policy == WRITE_THROUGH)
+            {
+                bufferWrite(cache, req->load_or_store_addr, storeBytes(req));
+            }
+            else
+            {
+                blk->dirty = true;
+            }
+        }
+
+        // RRIP hit promotion: predict near-immediate re-reference
+        if (cache->policy >= POLICY_SRRIP)
+        {
+            setRRPV(cache, blk->set, blk->way, 0);
         }
-        if (shct[blk->signature_memory] < shct_sat) {
-            shct[blk->signature_memory] += 1;
+
+        if (cache->policy == POLICY_SHIP && cache->shct[blk->signature_memory] < SHCT_MAX)
+        {
+            ++cache->shct[blk->signature_memory];
         }
-        
     }
 
     return hit;
@@ -118,50 +316,138 @@ bool accessBlock(Cache *cache, Request *req, uint64_t access_time)
 
 bool insertBlock(Cache *cache, Request *req, uint64_t access_time, uint64_t *wb_addr)
 {
+    cache->now = access_time;
+
+    // A no-write-allocate store miss goes around the cache
+    if (req->req_type == STORE && cache->allocate_policy == NO_WRITE_ALLOCATE)
+    {
+        if (cache->coherence != NULL)
+        {
+            coherenceMiss(cache->coherence, cache->core, req, false);
+        }
+        bufferWrite(cache, req->load_or_store_addr, storeBytes(req));
+        return false;
+    }
+
     // Step one, find a victim block
     uint64_t blk_aligned_addr = blkAlign(req->load_or_store_addr, cache->blk_mask);
 
+    // The fill is requested at the miss, ahead of any writeback it causes
+    if (cache->dram != NULL)
+    {
+        accessDRAM(cache->dram, blk_aligned_addr, false, access_time);
+    }
+
+    uint64_t set_idx = (blk_aligned_addr >> cache->set_shift) & cache->set_mask;
+
     Cache_Block *victim = NULL;
-    #ifdef LRU
-        bool wb_required = lru(cache, blk_aligned_addr, &victim, wb_addr);
-    #endif
-    
-    // Inserted LFU
-    #ifdef LFU
-        bool wb_required = lfu(cache, blk_aligned_addr, &victim, wb_addr);
-    #endif
-    
-    #ifdef SHiP
-        bool wb_required = lru(cache, blk_aligned_addr, &victim, wb_addr);
-    #endif
+    bool wb_required;
+    switch (cache->policy)
+    {
+        case POLICY_LRU:
+            wb_required = lru(cache, blk_aligned_addr, &victim, wb_addr);
+            break;
+        // Inserted LFU
+        case POLICY_LFU:
+            wb_required = lfu(cache, blk_aligned_addr, &victim, wb_addr);
+            break;
+        default:
+            wb_required = rrip(cache, blk_aligned_addr, &victim, wb_addr);
+            break;
+    }
     
     assert(victim != NULL);
 
-    if(!victim->outcome) {
-        shct[victim->signature_memory] -= 1;
+    // The directory hears of the eviction before the miss
+    bool exclusive = true;
+    if (cache->coherence != NULL)
+    {
+        if (wb_required)
+        {
+            coherenceEvict(cache->coherence, cache->core, *wb_addr);
+        }
+        exclusive = coherenceMiss(cache->coherence, cache->core, req, true);
     }
+
+    // SHiP, an evicted block that was never re-referenced trains its signature down
+    if (cache->policy == POLICY_SHIP && wb_required && !victim->outcome &&
+        cache->shct[victim->signature_memory] > 0)
+    {
+        --cache->shct[victim->signature_memory];
+    }
+
     // Step two, insert the new block
     uint64_t tag = req->load_or_store_addr >> cache->tag_shift;
     victim->tag = tag;
     victim->valid = true;
+    victim->exclusive = exclusive;
     victim->outcome = false;
-    #ifndef SHiP
     victim->when_touched = access_time;
     ++victim->frequency;
-
-    #endif
-    
-    #ifdef SHiP
     victim->PC = req->PC;
-    victim->signature_memory = (victim->PC & cache->sig_mask) >> (64 - signature_size);
-    if(shct[victim->signature_memory] > 0) {
-        victim->when_touched = access_time;
+    cache->read_bytes += cache->blk_mask + 1;
+    if (cache->tag_index != NULL)
+    {
+        indexBlock(cache, victim);
+    }
+
+    // Step three, RRIP insertion position
+    unsigned rrpv = RRPV_LONG;
+    Replacement_Policy insertion = cache->policy;
+
+    if (insertion == POLICY_DRRIP)
+    {
+        // Leader sets always use their policy and steer PSEL on a miss,
+        // follower sets use whichever leader misses less
+        unsigned leader = set_idx % cache->duel_constituency;
+        if (leader == 0)
+        {
+            insertion = POLICY_SRRIP;
+            if (cache->psel < PSEL_MAX)
+            {
+                ++cache->psel;
+            }
+        }
+        else if (leader == 1)
+        {
+            insertion = POLICY_BRRIP;
+            if (cache->psel > 0)
+            {
+                --cache->psel;
+            }
+        }
+        else
+        {
+            insertion = cache->psel > PSEL_MAX / 2 ? POLICY_BRRIP : POLICY_SRRIP;
+        }
+    }
+
+    if (insertion == POLICY_BRRIP)
+    {
+        // Mostly distant, occasionally long re-reference
+        rrpv = (cache->brrip_count++ % BRRIP_EPSILON == 0) ? RRPV_LONG : RRPV_MAX;
+    }
+    else if (insertion == POLICY_SHIP)
+    {
+        victim->signature_memory = getSignature(req->PC);
+        rrpv = cache->shct[victim->signature_memory] == 0 ? RRPV_MAX : RRPV_LONG;
+    }
+
+    if (cache->policy >= POLICY_SRRIP)
+    {
+        setRRPV(cache, victim->set, victim->way, rrpv);
     }
-    #endif
 
     if (req->req_type == STORE)
     {
-        victim->dirty = true;
+        if (cache->write_policy == WRITE_THROUGH)
+        {
+            bufferWrite(cache, req->load_or_store_addr, storeBytes(req));
+        }
+        else
+        {
+            victim->dirty = true;
+        }
     }
     
     return wb_required;
@@ -174,8 +460,117 @@ inline uint64_t blkAlign(uint64_t addr, uint64_t mask)
     return addr & ~mask;
 }
 
+static inline uint64_t chunkBytes(const Cache *cache, uint64_t mask)
+{
+    return (uint64_t)__builtin_popcountll(mask) << cache->chunk_shift;
+}
+
+// One write transaction leaves for the next level
+static void writeNext(Cache *cache, uint64_t blk_addr, uint64_t mask)
+{
+    cache->write_bytes += chunkBytes(cache, mask);
+    ++cache->num_writes;
+
+    if (cache->dram != NULL)
+    {
+        accessDRAM(cache->dram, blk_addr, true, cache->now);
+    }
+}
+
+uint64_t chunkMask(const Cache *cache, uint64_t addr, unsigned size)
+{
+    // Clipped to this block
+    uint64_t offset = addr & cache->blk_mask;
+    uint64_t end = offset + (size > 0 ? size : 1);
+    if (end > cache->blk_mask + 1)
+    {
+        end = cache->blk_mask + 1;
+    }
+    unsigned first = offset >> cache->chunk_shift;
+    unsigned last = (end - 1) >> cache->chunk_shift;
+
+    return (last - first == 63) ? ~0ULL : ((1ULL << (last - first + 1)) - 1) << first;
+}
+
+void bufferWrite(Cache *cache, uint64_t addr, unsigned size)
+{
+    uint64_t blk_addr = blkAlign(addr, cache->blk_mask);
+    uint64_t mask = chunkMask(cache, addr, size);
+
+    if (cache->write_buffer_depth == 0)
+    {
+        writeNext(cache, blk_addr, mask);
+        return;
+    }
+
+    // Coalesce with a pending write to the same block
+    unsigned i;
+    for (i = 0; i < cache->write_buffer_count; i++)
+    {
+        Write_Buffer_Entry *entry =
+            &(cache->write_buffer[(cache->write_buffer_head + i) % cache->write_buffer_depth]);
+        if (entry->blk_addr == blk_addr)
+        {
+            entry->mask |= mask;
+            ++cache->num_coalesced;
+            return;
+        }
+    }
+
+    // Full, drain the oldest entry to the next level
+    if (cache->write_buffer_count == cache->write_buffer_depth)
+    {
+        Write_Buffer_Entry *oldest = &(cache->write_buffer[cache->write_buffer_head]);
+        writeNext(cache, oldest->blk_addr, oldest->mask);
+
+        cache->write_buffer_head = (cache->write_buffer_head + 1) % cache->write_buffer_depth;
+        --cache->write_buffer_count;
+    }
+
+    Write_Buffer_Entry *entry = &(cache->write_buffer[(cache->write_buffer_head +
+                                  cache->write_buffer_count) % cache->write_buffer_depth]);
+    entry->blk_addr = blk_addr;
+    entry->mask = mask;
+    ++cache->write_buffer_count;
+}
+
+uint64_t pendingWriteBytes(const Cache *cache)
+{
+    uint64_t bytes = 0;
+
+    unsigned i;
+    for (i = 0; i < cache->write_buffer_count; i++)
+    {
+        bytes += chunkBytes(cache, cache->write_buffer[(cache->write_buffer_head + i) %
+                                                       cache->write_buffer_depth].mask);
+    }
+
+    return bytes;
+}
+
+void flushWriteBuffer(Cache *cache)
+{
+    while (cache->write_buffer_count > 0)
+    {
+        Write_Buffer_Entry *oldest = &(cache->write_buffer[cache->write_buffer_head]);
+        writeNext(cache, oldest->blk_addr, oldest->mask);
+
+        cache->write_buffer_head = (cache->write_buffer_head + 1) % cache->write_buffer_depth;
+        --cache->write_buffer_count;
+    }
+}
+
 Cache_Block *findBlock(Cache *cache, uint64_t addr)
 {
+    if (cache->engine != NULL)
+    {
+        return cache->engine->find_block(cache, addr);
+    }
+    if (cache->tag_index != NULL)
+    {
+        return findIndexedBlock(cache, addr);
+    }
+
 //    printf("Addr: %"PRIu64"\n", addr);
 
     // Extract tag
@@ -205,29 +600,57 @@ bool lru(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_add
     //    printf("Set: %"PRIu64"\n", set_idx);
     Cache_Block **ways = cache->sets[set_idx].ways;
 
-    // Step one, try to find an invalid block.
-    int i;
-    for (i = 0; i < cache->num_ways; i++)
+    Cache_Block *victim;
+    if (cache->engine != NULL)
     {
-        if (ways[i]->valid == false)
-        {
-            *victim_blk = ways[i];
-            return false; // No need to write-back
-        }
+        victim = cache->engine->lru_victim(cache, set_idx);
     }
-
-    // Step two, if there is no invalid block. Locate the LRU block
-    Cache_Block *victim = ways[0];
-    for (i = 1; i < cache->num_ways; i++)
+    else if (cache->tag_index != NULL)
     {
-        if (ways[i]->when_touched < victim->when_touched)
+        victim = indexedVictim(cache, set_idx);
+    }
+    else
+    {
+        // Step one, try to find an invalid block.
+        int i;
+        for (i = 0; i < cache->num_ways; i++)
+        {
+            if (ways[i]->valid == false)
+            {
+                break;
+            }
+        }
+        if (i < cache->num_ways)
         {
             victim = ways[i];
         }
+        else
+        {
+            // Step two, if there is no invalid block. Locate the LRU block
+            victim = ways[0];
+            for (i = 1; i < cache->num_ways; i++)
+            {
+                if (ways[i]->when_touched < victim->when_touched)
+                {
+                    victim = ways[i];
+                }
+            }
+        }
+    }
+
+    if (victim->valid == false)
+    {
+        *victim_blk = victim;
+        return false; // Nothing evicted
     }
 
     // Step three, need to write-back the victim block
     *wb_addr = (victim->tag << cache->tag_shift) | (victim->set << cache->set_shift);
+    if (victim->dirty)
+    {
+        ++cache->num_writebacks;
+        bufferWrite(cache, *wb_addr, cache->blk_mask + 1);
+    }
 //    uint64_t ori_addr = (victim->tag << cache->tag_shift) | (victim->set << cache->set_shift);
 //    printf("Evicted: %"PRIu64"\n", ori_addr);
 
@@ -237,10 +660,14 @@ bool lru(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_add
     victim->dirty = false;
     victim->frequency = 0;
     victim->when_touched = 0;
+    if (cache->tag_index != NULL)
+    {
+        unindexBlock(cache, victim, *wb_addr);
+    }
 
     *victim_blk = victim;
 
-    return true; // Need to write-back
+    return true; // Evicted a valid block, written back if dirty
 }
 
 // Inserted LFU Policy
@@ -250,29 +677,57 @@ bool lfu(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_add
     //    printf("Set: %"PRIu64"\n", set_idx);
     Cache_Block **ways = cache->sets[set_idx].ways;
 
-    // Step one, try to find an invalid block.
-    int i;
-    for (i = 0; i < cache->num_ways; i++)
+    Cache_Block *victim;
+    if (cache->engine != NULL)
     {
-        if (ways[i]->valid == false)
-        {
-            *victim_blk = ways[i];
-            return false; // No need to write-back
-        }
+        victim = cache->engine->lfu_victim(cache, set_idx);
     }
-
-    // Step two, if there is no invalid block. Locate the LFU block
-    Cache_Block *victim = ways[0];
-    for (i = 1; i < cache->num_ways; i++)
+    else if (cache->tag_index != NULL)
     {
-        if (ways[i]->frequency < victim->frequency)
+        victim = indexedVictim(cache, set_idx);
+    }
+    else
+    {
+        // Step one, try to find an invalid block.
+        int i;
+        for (i = 0; i < cache->num_ways; i++)
+        {
+            if (ways[i]->valid == false)
+            {
+                break;
+            }
+        }
+        if (i < cache->num_ways)
         {
             victim = ways[i];
         }
+        else
+        {
+            // Step two, if there is no invalid block. Locate the LFU block
+            victim = ways[0];
+            for (i = 1; i < cache->num_ways; i++)
+            {
+                if (ways[i]->frequency < victim->frequency)
+                {
+                    victim = ways[i];
+                }
+            }
+        }
+    }
+
+    if (victim->valid == false)
+    {
+        *victim_blk = victim;
+        return false; // Nothing evicted
     }
 
     // Step three, need to write-back the victim block
     *wb_addr = (victim->tag << cache->tag_shift) | (victim->set << cache->set_shift);
+    if (victim->dirty)
+    {
+        ++cache->num_writebacks;
+        bufferWrite(cache, *wb_addr, cache->blk_mask + 1);
+    }
 //    uint64_t ori_addr = (victim->tag << cache->tag_shift) | (victim->set << cache->set_shift);
 //    printf("Evicted: %"PRIu64"\n", ori_addr);
 
@@ -282,9 +737,180 @@ bool lfu(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_add
     victim->dirty = false;
     victim->frequency = 0;
     victim->when_touched = 0;
+    if (cache->tag_index != NULL)
+    {
+        unindexBlock(cache, victim, *wb_addr);
+    }
 
     *victim_blk = victim;
 
-    return true; // Need to write-back
+    return true; // Evicted a valid block, written back if dirty
 }
 
+// The first block at RRPV_MAX after ageing a set whose ways are all valid
+static Cache_Block *scanRRIPVictim(Cache *cache, uint64_t set_idx)
+{
+    Cache_Block **ways = cache->sets[set_idx].ways;
+
+    // Age the set so its oldest block reaches RRPV_MAX. Ageing one step at
+    // a time until a block hits RRPV_MAX is the same as adding
+    // (RRPV_MAX - max) to every block, done a packed word at a time.
+    uint64_t *words = &(cache->rrpv[set_idx * cache->rrpv_words]);
+    unsigned max_rrpv = 0;
+    int i;
+    for (i = 0; i < cache->num_ways; i++)
+    {
+        unsigned rrpv = getRRPV(cache, set_idx, i);
+        if (rrpv > max_rrpv)
+        {
+            max_rrpv = rrpv;
+        }
+    }
+
+    unsigned w;
+    if (max_rrpv < RRPV_MAX)
+    {
+        // No field can carry into its neighbour since all are < RRPV_MAX
+        uint64_t ones = 0x5555555555555555ULL * (RRPV_MAX - max_rrpv);
+        for (w = 0; w < cache->rrpv_words; w++)
+        {
+            unsigned fields = cache->num_ways - w * 32;
+            uint64_t used = fields >= 32 ? ~0ULL : (1ULL << (fields * RRPV_BITS)) - 1;
+            words[w] += ones & used;
+        }
+    }
+
+    for (w = 0; w < cache->rrpv_words; w++)
+    {
+        uint64_t at_max = words[w] & (words[w] >> 1) & 0x5555555555555555ULL;
+        if (at_max != 0)
+        {
+            return ways[w * 32 + __builtin_ctzll(at_max) / RRPV_BITS];
+        }
+    }
+    return NULL;
+}
+
+// RRIP victim search, shared by SRRIP, BRRIP, DRRIP and SHiP
+bool rrip(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_addr)
+{
+    uint64_t set_idx = (addr >> cache->set_shift) & cache->set_mask;
+    Cache_Block **ways = cache->sets[set_idx].ways;
+
+    // Step one, try to find an invalid block; a wide set's heap root is
+    // invalid if any of its blocks is
+    if (cache->tag_index != NULL)
+    {
+        Cache_Block *root = indexedVictim(cache, set_idx);
+        if (root->valid == false)
+        {
+            *victim_blk = root;
+            return false; // Nothing evicted
+        }
+    }
+    else
+    {
+        int i;
+        for (i = 0; i < cache->num_ways; i++)
+        {
+            if (ways[i]->valid == false)
+            {
+                *victim_blk = ways[i];
+                return false; // Nothing evicted
+            }
+        }
+    }
+
+    // Steps two and three, age the set and take the first block at
+    // RRPV_MAX; wide sets keep per-RRPV buckets for it (see Tag_Index.h)
+    Cache_Block *victim = cache->tag_index != NULL ? indexedRRIPVictim(cache, set_idx) :
+                                                     scanRRIPVictim(cache, set_idx);
+    assert(victim != NULL);
+
+    // Step four, need to write-back the victim block
+    *wb_addr = (victim->tag << cache->tag_shift) | (victim->set << cache->set_shift);
+    if (victim->dirty)
+    {
+        ++cache->num_writebacks;
+        bufferWrite(cache, *wb_addr, cache->blk_mask + 1);
+    }
+
+    // Step five, invalidate victim
+    victim->tag = UINTMAX_MAX;
+    victim->valid = false;
+    victim->dirty = false;
+    victim->frequency = 0;
+    victim->when_touched = 0;
+    if (cache->tag_index != NULL)
+    {
+        unindexBlock(cache, victim, *wb_addr);
+    }
+
+    *victim_blk = victim;
+
+    return true; // Evicted a valid block, written back if dirty
+}
+
+inline unsigned getRRPV(Cache *cache, uint32_t set, uint32_t way)
+{
+    if (cache->tag_index != NULL)
+    {
+        return getIndexedRRPV(cache, set, way);
+    }
+
+    uint64_t word = cache->rrpv[set * cache->rrpv_words + way / 32];
+
+    return (word >> ((way % 32) * RRPV_BITS)) & RRPV_MAX;
+}
+
+inline void setRRPV(Cache *cache, uint32_t set, uint32_t way, unsigned rrpv)
+{
+    if (cache->tag_index != NULL)
+    {
+        setIndexedRRPV(cache, set, way, rrpv);
+        return;
+    }
+
+    uint64_t *word = &(cache->rrpv[set * cache->rrpv_words + way / 32]);
+    unsigned shift = (way % 32) * RRPV_BITS;
+
+    *word = (*word & ~((uint64_t)RRPV_MAX << shift)) | ((uint64_t)rrpv << shift);
+}
+
+Replacement_Policy parseReplacementPolicy(const char *name)
+{
+    int i;
+    for (i = 0; i < sizeof(policy_names) / sizeof(policy_names[0]); i++)
+    {
+        if (strcmp(name, policy_names[i]) == 0)
+        {
+            return (Replacement_Policy)i;
+        }
+    }
+
+    return (Replacement_Policy)-1;
+}
+
+const char *replacementPolicyName(Replacement_Policy policy)
+{
+    return policy_names[policy];
+}
+
+Write_Policy parseWritePolicy(const char *name)
+{
+    int i;
+    for (i = 0; i < sizeof(write_policy_names) / sizeof(write_policy_names[0]); i++)
+    {
+        if (strcmp(name, write_policy_names[i]) == 0)
+        {
+            return (Write_Policy)i;
+        }
+    }
+
+    return (Write_Policy)-1;
+}
+
+const char *writePolicyName(Write_Policy policy)
+{
+    return write_policy_names[policy];
+}
@@ -5,25 +5,81 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <math.h>
 #include <stdint.h>
 
 #include "Cache_Blk.h"
 #include "Request.h"
+#include "Cache_Engine.h"
+#include "Tag_Index.h"
 
+// Default replacement policy
 // #define LRU
 //#define LFU
+//#define SRRIP
+//#define BRRIP
+//#define DRRIP
 #define SHiP
 
+typedef enum Replacement_Policy{POLICY_LRU, POLICY_LFU, POLICY_SRRIP, POLICY_BRRIP,
+                                POLICY_DRRIP, POLICY_SHIP}Replacement_Policy;
+
+// Re-reference interval prediction (RRIP): 2-bit RRPV per block
+#define RRPV_BITS 2
+#define RRPV_MAX ((1 << RRPV_BITS) - 1) // Distant re-reference, evicted first
+#define RRPV_LONG (RRPV_MAX - 1)        // SRRIP insertion
+#define BRRIP_EPSILON 32                // BRRIP inserts at RRPV_LONG once per 32 misses
+
+// DRRIP set dueling
+#define DUEL_LEADER_SETS 32             // Leader sets per policy
+#define PSEL_BITS 10
+#define PSEL_MAX ((1 << PSEL_BITS) - 1)
+
+// SHiP signature history counter table (Wu et al., MICRO 2011)
+#define SHCT_ENTRIES (1 << 14)          // 14-bit PC signatures
+#define SHCT_MAX 7                      // 3-bit saturating counters
+
+// Write hits: write-back marks the block dirty, write-through forwards the
+// store to the next level. Write misses: write-allocate fills the block
+// first, no-write-allocate forwards the store without filling.
+typedef enum Write_Policy{WRITE_BACK, WRITE_THROUGH}Write_Policy;
+typedef enum Allocate_Policy{WRITE_ALLOCATE, NO_WRITE_ALLOCATE}Allocate_Policy;
+
+#define STORE_BYTES 8 // Store size when a request does not carry one
+#define WRITE_BUFFER_MAX_DEPTH 4096 // Entries, each write scans the buffer
+
+// Coalescing write buffer in front of the next level. Every write to the
+// next level (write-through stores, no-allocate store misses, dirty
+// victims) goes through it; a write to a block already buffered merges
+// into its entry. When the buffer is full its oldest entry drains. Bytes
+// are tracked in 64 chunks per block, exact up to 64B blocks.
+typedef struct Write_Buffer_Entry
+{
+    uint64_t blk_addr;
+    uint64_t mask; // Chunks of the block written
+}Write_Buffer_Entry;
+
+// Per-instance cache parameters
+typedef struct Cache_Config
+{
+    unsigned block_size; // Bytes
+    unsigned cache_size; // KB
+    unsigned assoc;
+    Replacement_Policy policy;
+
+    Write_Policy write_policy;
+    Allocate_Policy allocate_policy;
+    unsigned write_buffer_depth; // Entries, 0 sends every write straight on
+}Cache_Config;
+
 /* Cache */
 typedef struct Set
 {
     Cache_Block **ways; // Block ways within a set
 }Set;
 
-unsigned int shct[UINT32_MAX];
-
 typedef struct Cache
 {
     uint64_t blk_mask;
@@ -38,18 +94,79 @@ typedef struct Cache
     unsigned set_shift;
     unsigned set_mask; // To extract set index
     unsigned tag_shift; // To extract tag
-    uint64_t sig_mask;
     Set *sets; // All the sets of a cache
+
+    Replacement_Policy policy;
+
+    // RRIP state: RRPVs packed 32 per word, rrpv_words words per set
+    uint64_t *rrpv;
+    unsigned rrpv_words;
+    unsigned psel; // DRRIP policy selector, > PSEL_MAX / 2 follows BRRIP
+    unsigned duel_constituency; // Sets per leader-set pair
+    unsigned brrip_count; // Misses since the last BRRIP long insertion
+
+    uint8_t *shct; // SHiP signature history counters
+
+    const struct Cache_Engine *engine; // Specialized lookup, NULL for the generic one
+    struct Tag_Index *tag_index; // Hashed lookup for wide sets, NULL if none (see Tag_Index.h)
+
+    uint64_t num_writebacks; // Evicted victims that were dirty
+
+    Write_Policy write_policy;
+    Allocate_Policy allocate_policy;
+
+    Write_Buffer_Entry *write_buffer; // Ring of write_buffer_depth entries
+    unsigned write_buffer_depth;
+    unsigned write_buffer_head; // Oldest entry
+    unsigned write_buffer_count;
+    unsigned chunk_shift; // log2 of the bytes per mask bit
+
+    // Traffic to the next level, writes count once they leave the buffer
+    uint64_t read_bytes; // Block fills
+    uint64_t write_bytes;
+    uint64_t num_writes; // Write transactions
+    uint64_t num_coalesced; // Writes merged into a buffered entry
+
+    // Backend behind the fills and the writes leaving the buffer, NULL if
+    // none (see DRAM.h). It sees them at the time of the current access.
+    struct DRAM *dram;
+    uint64_t now;
+
+    // Directory keeping this private cache coherent, NULL if none (see
+    // Coherence.h), and the core it belongs to
+    struct Coherence *coherence;
+    unsigned core;
+
+    // Snapshot mapping backing the blocks (see Snapshot.c), NULL if none
+    void *snapshot_base;
+    size_t snapshot_len;
     
 }Cache;
 
 // Function Definitions
 Cache *initCache();
+Cache *initCacheGeometry(unsigned block_size, unsigned cache_size, unsigned assoc);
+void initCacheConfig(Cache_Config *config);
+// Reject what initCacheGeometry() would assert on
+bool checkCacheConfig(const Cache_Config *config);
+Cache *initCacheFromConfig(const Cache_Config *config);
+void freeCache(Cache *cache);
+void configureWrites(Cache *cache, Write_Policy write_policy, Allocate_Policy allocate_policy,
+                     unsigned write_buffer_depth);
 bool accessBlock(Cache *cache, Request *req, uint64_t access_time);
 bool insertBlock(Cache *cache, Request *req, uint64_t access_time, uint64_t *wb_addr);
 
 // Helper Function
 uint64_t blkAlign(uint64_t addr, uint64_t mask);
+
+// Chunks of the block covered by [addr, addr + size), see Write_Buffer_Entry
+uint64_t chunkMask(const Cache *cache, uint64_t addr, unsigned size);
+// Write [addr, addr + size) to the next level through the write buffer
+void bufferWrite(Cache *cache, uint64_t addr, unsigned size);
+// Bytes still waiting in the write buffer
+uint64_t pendingWriteBytes(const Cache *cache);
+// Drain every buffered write to the next level
+void flushWriteBuffer(Cache *cache);
 Cache_Block *findBlock(Cache *cache, uint64_t addr);
 
 // Replacement Policies
@@ -58,4 +175,13 @@ bool lru(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_add
 // Implementing LFU
 bool lfu(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_addr);
 
+// SRRIP, BRRIP, DRRIP and SHiP share the RRIP victim search
+bool rrip(Cache *cache, uint64_t addr, Cache_Block **victim_blk, uint64_t *wb_addr);
+unsigned getRRPV(Cache *cache, uint32_t set, uint32_t way);
+void setRRPV(Cache *cache, uint32_t set, uint32_t way, unsigned rrpv);
+Replacement_Policy parseReplacementPolicy(const char *name);
+const char *replacementPolicyName(Replacement_Policy policy);
+Write_Policy parseWritePolicy(const char *name);
+const char *writePolicyName(Write_Policy policy);
+
 #endif
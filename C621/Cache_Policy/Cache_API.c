@@ -0,0 +1,137 @@
+#include "Cache_API.h"
+
+#include "Request.h"
+#include "Cache.h"
+
+struct Cache_Sim
+{
+    Cache *cache;
+    uint64_t cycles; // Timestamp of the next request
+
+    uint64_t num_of_reqs;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t base_writebacks; // Cache counters at the last reset
+    uint64_t base_read_bytes;
+    uint64_t base_write_bytes;
+};
+
+// The Cache_API.h enums list their values in the order of the internal ones
+static void toCacheSimConfig(Cache_Sim_Config *sim_config, const Cache_Config *config)
+{
+    sim_config->block_size = config->block_size;
+    sim_config->cache_size = config->cache_size;
+    sim_config->assoc = config->assoc;
+    sim_config->policy = (Cache_Sim_Policy)config->policy;
+    sim_config->write_policy = (Cache_Write_Policy)config->write_policy;
+    sim_config->allocate_policy = (Cache_Allocate_Policy)config->allocate_policy;
+    sim_config->write_buffer_depth = config->write_buffer_depth;
+}
+
+static void fromCacheSimConfig(Cache_Config *config, const Cache_Sim_Config *sim_config)
+{
+    config->block_size = sim_config->block_size;
+    config->cache_size = sim_config->cache_size;
+    config->assoc = sim_config->assoc;
+    config->policy = (Replacement_Policy)sim_config->policy;
+    config->write_policy = (Write_Policy)sim_config->write_policy;
+    config->allocate_policy = (Allocate_Policy)sim_config->allocate_policy;
+    config->write_buffer_depth = sim_config->write_buffer_depth;
+}
+
+void initCacheSimConfig(Cache_Sim_Config *sim_config)
+{
+    Cache_Config config;
+    initCacheConfig(&config);
+    toCacheSimConfig(sim_config, &config);
+}
+
+Cache_Sim *createCacheSim(const Cache_Sim_Config *sim_config)
+{
+    Cache_Config config;
+    if (sim_config == NULL)
+    {
+        initCacheConfig(&config);
+    }
+    else
+    {
+        fromCacheSimConfig(&config, sim_config);
+    }
+
+    if (!checkCacheConfig(&config))
+    {
+        return NULL;
+    }
+
+    Cache_Sim *sim = (Cache_Sim *)calloc(1, sizeof(Cache_Sim));
+    sim->cache = initCacheFromConfig(&config);
+
+    return sim;
+}
+
+bool pushRequest(Cache_Sim *sim, const Cache_Request *sim_req)
+{
+    ++sim->num_of_reqs;
+    uint64_t cycles = sim->cycles++;
+
+    Request req;
+    req.req_type = sim_req->req_type == CACHE_STORE ? STORE : LOAD;
+    req.load_or_store_addr = sim_req->load_or_store_addr;
+    req.PC = sim_req->PC;
+    req.core_id = sim_req->core_id;
+    req.size = sim_req->size;
+
+    if (accessBlock(sim->cache, &req, cycles))
+    {
+        ++sim->hits;
+        return true;
+    }
+
+    ++sim->misses;
+    uint64_t wb_addr;
+    if (insertBlock(sim->cache, &req, cycles, &wb_addr))
+    {
+        ++sim->evictions;
+    }
+    return false;
+}
+
+void pushRequests(Cache_Sim *sim, const Cache_Request *reqs, size_t num_reqs)
+{
+    size_t i;
+    for (i = 0; i < num_reqs; i++)
+    {
+        pushRequest(sim, &reqs[i]);
+    }
+}
+
+void getCacheStats(const Cache_Sim *sim, Cache_Stats *stats)
+{
+    stats->num_of_reqs = sim->num_of_reqs;
+    stats->hits = sim->hits;
+    stats->misses = sim->misses;
+    stats->evictions = sim->evictions;
+    stats->writebacks = sim->cache->num_writebacks - sim->base_writebacks;
+    stats->read_bytes = sim->cache->read_bytes - sim->base_read_bytes;
+    stats->write_bytes = sim->cache->write_bytes + pendingWriteBytes(sim->cache) - sim->base_write_bytes;
+
+    stats->hit_rate = sim->num_of_reqs ? (double)sim->hits / sim->num_of_reqs : 0;
+}
+
+void resetCacheStats(Cache_Sim *sim)
+{
+    sim->num_of_reqs = 0;
+    sim->hits = 0;
+    sim->misses = 0;
+    sim->evictions = 0;
+    sim->base_writebacks = sim->cache->num_writebacks;
+    sim->base_read_bytes = sim->cache->read_bytes;
+    sim->base_write_bytes = sim->cache->write_bytes + pendingWriteBytes(sim->cache);
+}
+
+void destroyCacheSim(Cache_Sim *sim)
+{
+    freeCache(sim->cache);
+    free(sim);
+}
@@ -0,0 +1,91 @@
+#ifndef __CACHE_API_H__
+#define __CACHE_API_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// In-process cache simulation, built as libcache.a / libcache.so
+// ("make lib"). Every instance owns its blocks, RRIP and SHiP state, so any
+// number can run side by side, including on different threads (one thread
+// per instance).
+//
+// Only the functions below are exported from the shared library; the
+// simulator handle is opaque. The header stands alone, every type it
+// declares is prefixed, so it can share a translation unit with
+// Predictor_API.h. CACHE_API_VERSION changes whenever a signature or a
+// struct below does.
+#define CACHE_API_VERSION 3
+
+#define CACHE_API __attribute__((visibility("default")))
+
+typedef struct Cache_Sim Cache_Sim;
+
+typedef enum Cache_Sim_Policy{CACHE_LRU, CACHE_LFU, CACHE_SRRIP, CACHE_BRRIP,
+                              CACHE_DRRIP, CACHE_SHIP}Cache_Sim_Policy;
+typedef enum Cache_Write_Policy{CACHE_WRITE_BACK, CACHE_WRITE_THROUGH}Cache_Write_Policy;
+typedef enum Cache_Allocate_Policy{CACHE_WRITE_ALLOCATE,
+                                   CACHE_NO_WRITE_ALLOCATE}Cache_Allocate_Policy;
+
+typedef struct Cache_Sim_Config
+{
+    unsigned block_size; // Bytes
+    unsigned cache_size; // KB
+    unsigned assoc;
+    Cache_Sim_Policy policy;
+
+    Cache_Write_Policy write_policy;
+    Cache_Allocate_Policy allocate_policy;
+    unsigned write_buffer_depth; // Entries, 0 sends every write straight on, at most 4096
+}Cache_Sim_Config;
+
+typedef enum Cache_Request_Type{CACHE_LOAD, CACHE_STORE}Cache_Request_Type;
+
+typedef struct Cache_Request
+{
+    Cache_Request_Type req_type;
+    uint64_t load_or_store_addr;
+    uint64_t PC; // The instruction that brings the cache block, SHiP's signature
+    int core_id;
+    int size; // Bytes accessed, 0 if unknown
+}Cache_Request;
+
+typedef struct Cache_Stats
+{
+    uint64_t num_of_reqs;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks; // Dirty victims
+
+    // Traffic to the next level; writes include what the write buffer holds
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+
+    double hit_rate; // 0 with no requests
+}Cache_Stats;
+
+// Fill config with the default geometry, replacement and write policies,
+// then adjust any field
+CACHE_API void initCacheSimConfig(Cache_Sim_Config *config);
+
+// A cold cache, the default one when config is NULL. Returns NULL for an
+// invalid configuration (sizes that are not powers of two, no sets, ...).
+CACHE_API Cache_Sim *createCacheSim(const Cache_Sim_Config *config);
+
+// Simulate one request, inserting the block on a miss. Returns true on a
+// hit. Requests are timestamped in the order they are pushed. A store with
+// a size of 0 writes 8 bytes.
+CACHE_API bool pushRequest(Cache_Sim *sim, const Cache_Request *req);
+
+// Simulate num_reqs requests from a buffer, in order
+CACHE_API void pushRequests(Cache_Sim *sim, const Cache_Request *reqs, size_t num_reqs);
+
+CACHE_API void getCacheStats(const Cache_Sim *sim, Cache_Stats *stats);
+
+// Zero the statistics but keep the cache contents, e.g. after a warmup
+CACHE_API void resetCacheStats(Cache_Sim *sim);
+
+CACHE_API void destroyCacheSim(Cache_Sim *sim);
+
+#endif
@@ -12,6 +12,7 @@ typedef struct Cache_Block
 
     bool valid; // Is this block valid?
     bool dirty; // Has this block been modified?
+    bool exclusive; // MESI E or M: no other private cache holds it
 
     uint64_t when_touched; // The last time this block is referenced.
     uint64_t frequency; // How many times this block is referenced.
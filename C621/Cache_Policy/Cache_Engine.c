@@ -0,0 +1,117 @@
+#include "Cache.h"
+
+// Blocks of set s are blocks[s * WAYS .. s * WAYS + WAYS - 1] (see
+// initCacheGeometry()), so the specialized functions index them directly
+// instead of going through the ways pointer array.
+#define CACHE_ENGINE(BLK, SETS, WAYS) \
+static Cache_Block *findBlock_##BLK##_##SETS##_##WAYS(Cache *cache, uint64_t addr) \
+{ \
+    uint64_t tag = addr / ((uint64_t)(BLK) * (SETS)); \
+    uint64_t set_idx = (addr / (BLK)) % (SETS); \
+    Cache_Block *ways = &(cache->blocks[set_idx * (WAYS)]); \
+    int i; \
+    _Pragma("GCC unroll 16") \
+    for (i = 0; i < (WAYS); i++) \
+    { \
+        if (tag == ways[i].tag && ways[i].valid == true) \
+        { \
+            return &(ways[i]); \
+        } \
+    } \
+    return NULL; \
+} \
+\
+static Cache_Block *lruVictim_##BLK##_##SETS##_##WAYS(Cache *cache, uint64_t set_idx) \
+{ \
+    Cache_Block *ways = &(cache->blocks[set_idx * (WAYS)]); \
+    Cache_Block *victim = &(ways[0]); \
+    int i; \
+    _Pragma("GCC unroll 16") \
+    for (i = 0; i < (WAYS); i++) \
+    { \
+        if (ways[i].valid == false) \
+        { \
+            return &(ways[i]); \
+        } \
+        if (ways[i].when_touched < victim->when_touched) \
+        { \
+            victim = &(ways[i]); \
+        } \
+    } \
+    return victim; \
+} \
+\
+static Cache_Block *lfuVictim_##BLK##_##SETS##_##WAYS(Cache *cache, uint64_t set_idx) \
+{ \
+    Cache_Block *ways = &(cache->blocks[set_idx * (WAYS)]); \
+    Cache_Block *victim = &(ways[0]); \
+    int i; \
+    _Pragma("GCC unroll 16") \
+    for (i = 0; i < (WAYS); i++) \
+    { \
+        if (ways[i].valid == false) \
+        { \
+            return &(ways[i]); \
+        } \
+        if (ways[i].frequency < victim->frequency) \
+        { \
+            victim = &(ways[i]); \
+        } \
+    } \
+    return victim; \
+}
+
+#define ENGINE_ENTRY(BLK, SETS, WAYS) \
+    {BLK, SETS, WAYS, findBlock_##BLK##_##SETS##_##WAYS, \
+     lruVictim_##BLK##_##SETS##_##WAYS, lfuVictim_##BLK##_##SETS##_##WAYS}
+
+// 64B blocks; 128KB, 256KB, 512KB, 1MB and 2MB; 4, 8 and 16 ways
+CACHE_ENGINE(64, 512, 4)
+CACHE_ENGINE(64, 256, 8)
+CACHE_ENGINE(64, 128, 16)
+CACHE_ENGINE(64, 1024, 4)
+CACHE_ENGINE(64, 512, 8)
+CACHE_ENGINE(64, 256, 16)
+CACHE_ENGINE(64, 2048, 4)
+CACHE_ENGINE(64, 1024, 8)
+CACHE_ENGINE(64, 512, 16)
+CACHE_ENGINE(64, 4096, 4)
+CACHE_ENGINE(64, 2048, 8)
+CACHE_ENGINE(64, 1024, 16)
+CACHE_ENGINE(64, 8192, 4)
+CACHE_ENGINE(64, 4096, 8)
+CACHE_ENGINE(64, 2048, 16)
+
+static const Cache_Engine engines[] =
+{
+    ENGINE_ENTRY(64, 512, 4),
+    ENGINE_ENTRY(64, 256, 8),
+    ENGINE_ENTRY(64, 128, 16),
+    ENGINE_ENTRY(64, 1024, 4),
+    ENGINE_ENTRY(64, 512, 8),
+    ENGINE_ENTRY(64, 256, 16),
+    ENGINE_ENTRY(64, 2048, 4),
+    ENGINE_ENTRY(64, 1024, 8),
+    ENGINE_ENTRY(64, 512, 16),
+    ENGINE_ENTRY(64, 4096, 4),
+    ENGINE_ENTRY(64, 2048, 8),
+    ENGINE_ENTRY(64, 1024, 16),
+    ENGINE_ENTRY(64, 8192, 4),
+    ENGINE_ENTRY(64, 4096, 8),
+    ENGINE_ENTRY(64, 2048, 16),
+};
+
+const Cache_Engine *findCacheEngine(unsigned block_size, unsigned num_sets, unsigned num_ways)
+{
+    int i;
+    for (i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+    {
+        if (engines[i].block_size == block_size && engines[i].num_sets == num_sets &&
+            engines[i].num_ways == num_ways)
+        {
+            return &(engines[i]);
+        }
+    }
+
+    return NULL;
+}
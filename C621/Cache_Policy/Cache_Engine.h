@@ -0,0 +1,29 @@
+#ifndef __CACHE_ENGINE_H__
+#define __CACHE_ENGINE_H__
+
+#include "Cache_Blk.h"
+
+struct Cache;
+
+// Lookup and victim search specialized for one fixed geometry. Block size,
+// set count and associativity are compile-time constants inside these
+// functions, so the way loops unroll and the shifts and masks are immediates.
+typedef struct Cache_Engine
+{
+    unsigned block_size;
+    unsigned num_sets;
+    unsigned num_ways;
+
+    Cache_Block *(*find_block)(struct Cache *cache, uint64_t addr);
+
+    // Return the first invalid way of the set, or else the way with the
+    // smallest when_touched (LRU) / frequency (LFU).
+    Cache_Block *(*lru_victim)(struct Cache *cache, uint64_t set_idx);
+    Cache_Block *(*lfu_victim)(struct Cache *cache, uint64_t set_idx);
+}Cache_Engine;
+
+// Engine built for the given geometry, NULL if there is none and the
+// generic lookup has to be used.
+const Cache_Engine *findCacheEngine(unsigned block_size, unsigned num_sets, unsigned num_ways);
+
+#endif
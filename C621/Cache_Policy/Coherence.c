@@ -0,0 +1,520 @@
+#include "Coherence.h"
+
+#define DIRECTORY_SLOTS 1024 // Initial capacity, doubles at 3/4 load
+
+static unsigned log2u(uint64_t x)
+{
+    unsigned bits = 0;
+    while (x > 1)
+    {
+        x >>= 1;
+        ++bits;
+    }
+    return bits;
+}
+
+static inline unsigned accessBytes(Request *req)
+{
+    return req->size > 0 ? req->size : STORE_BYTES;
+}
+
+/* Directory */
+static inline uint64_t *sharers(Coherence *coh, uint64_t slot)
+{
+    return &(coh->masks[slot * 2 * coh->mask_words]);
+}
+
+static inline uint64_t *lost(Coherence *coh, uint64_t slot)
+{
+    return &(coh->masks[(slot * 2 + 1) * coh->mask_words]);
+}
+
+static inline bool testBit(const uint64_t *mask, unsigned core)
+{
+    return (mask[core / 64] >> (core % 64)) & 1;
+}
+
+static inline void setBit(uint64_t *mask, unsigned core)
+{
+    mask[core / 64] |= 1ULL << (core % 64);
+}
+
+static inline void clearBit(uint64_t *mask, unsigned core)
+{
+    mask[core / 64] &= ~(1ULL << (core % 64));
+}
+
+static bool emptyMask(const uint64_t *mask, unsigned words)
+{
+    unsigned w;
+    for (w = 0; w < words; w++)
+    {
+        if (mask[w] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline uint64_t homeSlot(Coherence *coh, uint64_t blk_addr)
+{
+    return ((blk_addr >> coh->blk_shift) * 0x9E3779B97F4A7C15ULL) >> coh->hash_shift;
+}
+
+static void allocDirectory(Coherence *coh, uint64_t capacity)
+{
+    coh->capacity = capacity;
+    coh->hash_shift = 64 - log2u(capacity);
+    coh->num_entries = 0;
+
+    coh->entries = (Directory_Entry *)malloc(capacity * sizeof(Directory_Entry));
+    coh->masks = (uint64_t *)calloc(capacity * 2 * coh->mask_words, sizeof(uint64_t));
+
+    uint64_t i;
+    for (i = 0; i < capacity; i++)
+    {
+        coh->entries[i].blk_addr = DIRECTORY_EMPTY;
+    }
+}
+
+static void growDirectory(Coherence *coh)
+{
+    Directory_Entry *old_entries = coh->entries;
+    uint64_t *old_masks = coh->masks;
+    uint64_t old_capacity = coh->capacity;
+    size_t mask_bytes = 2 * coh->mask_words * sizeof(uint64_t);
+
+    allocDirectory(coh, old_capacity * 2);
+
+    uint64_t i;
+    for (i = 0; i < old_capacity; i++)
+    {
+        if (old_entries[i].blk_addr == DIRECTORY_EMPTY)
+        {
+            continue;
+        }
+
+        uint64_t slot = homeSlot(coh, old_entries[i].blk_addr);
+        while (coh->entries[slot].blk_addr != DIRECTORY_EMPTY)
+        {
+            slot = (slot + 1) & (coh->capacity - 1);
+        }
+        coh->entries[slot] = old_entries[i];
+        memcpy(sharers(coh, slot), &(old_masks[i * 2 * coh->mask_words]), mask_bytes);
+        ++coh->num_entries;
+    }
+
+    free(old_entries);
+    free(old_masks);
+}
+
+// Slot of blk_addr, added with no sharers if create is set, else -1 if absent
+static int64_t findEntry(Coherence *coh, uint64_t blk_addr, bool create)
+{
+    uint64_t slot = homeSlot(coh, blk_addr);
+    while (coh->entries[slot].blk_addr != DIRECTORY_EMPTY)
+    {
+        if (coh->entries[slot].blk_addr == blk_addr)
+        {
+            return slot;
+        }
+        slot = (slot + 1) & (coh->capacity - 1);
+    }
+
+    if (!create)
+    {
+        return -1;
+    }
+
+    if ((coh->num_entries + 1) * 4 > coh->capacity * 3)
+    {
+        growDirectory(coh);
+        return findEntry(coh, blk_addr, true);
+    }
+
+    memset(&(coh->entries[slot]), 0, sizeof(Directory_Entry));
+    coh->entries[slot].blk_addr = blk_addr;
+    ++coh->num_entries;
+
+    return slot;
+}
+
+// Drop an entry, with its lost mask. Later entries of the probe run shift
+// back so lookups never cross a hole.
+static void removeEntry(Coherence *coh, uint64_t slot)
+{
+    size_t mask_bytes = 2 * coh->mask_words * sizeof(uint64_t);
+    uint64_t hole = slot;
+    uint64_t next = (slot + 1) & (coh->capacity - 1);
+    while (coh->entries[next].blk_addr != DIRECTORY_EMPTY)
+    {
+        // An entry may fill the hole if its home is not in (hole, next]
+        uint64_t home = homeSlot(coh, coh->entries[next].blk_addr);
+        if (((next - home) & (coh->capacity - 1)) >= ((next - hole) & (coh->capacity - 1)))
+        {
+            coh->entries[hole] = coh->entries[next];
+            memcpy(sharers(coh, hole), sharers(coh, next), mask_bytes);
+            hole = next;
+        }
+        next = (next + 1) & (coh->capacity - 1);
+    }
+
+    coh->entries[hole].blk_addr = DIRECTORY_EMPTY;
+    memset(sharers(coh, hole), 0, mask_bytes);
+    --coh->num_entries;
+}
+
+// Drop an entry nobody holds. One with lost copies stays, taking the place
+// of the longest released one in the ring, which goes if still unheld.
+static void releaseEntry(Coherence *coh, uint64_t slot)
+{
+    if (!emptyMask(sharers(coh, slot), coh->mask_words))
+    {
+        return;
+    }
+    if (emptyMask(lost(coh, slot), coh->mask_words))
+    {
+        removeEntry(coh, slot);
+        return;
+    }
+
+    Directory_Entry *entry = &(coh->entries[slot]);
+    entry->released = ++coh->releases;
+
+    Released_Block oldest = coh->lost_blocks[coh->lost_next];
+    coh->lost_blocks[coh->lost_next].blk_addr = entry->blk_addr;
+    coh->lost_blocks[coh->lost_next].released = entry->released;
+    coh->lost_next = (coh->lost_next + 1) % COHERENCE_LOST_BLOCKS;
+
+    // Removing it may move this entry, which is not used past here
+    if (oldest.blk_addr != DIRECTORY_EMPTY)
+    {
+        int64_t old_slot = findEntry(coh, oldest.blk_addr, false);
+        if (old_slot >= 0 && coh->entries[old_slot].released == oldest.released &&
+            emptyMask(sharers(coh, old_slot), coh->mask_words))
+        {
+            removeEntry(coh, old_slot);
+        }
+    }
+}
+
+/* Event sketch */
+// Count one coherence event on blk_addr and return its counters
+static Block_Events *blockEvent(Coherence *coh, uint64_t blk_addr)
+{
+    int slot = findSketchKey(coh->event_sketch, blk_addr);
+    if (slot < 0)
+    {
+        slot = admitSketchKey(coh->event_sketch, blk_addr);
+        memset(&(coh->tracked[slot]), 0, sizeof(Block_Events));
+    }
+
+    countSketchSlot(coh->event_sketch, slot);
+    return &(coh->tracked[slot]);
+}
+
+/* Protocol */
+Coherence *initCoherence(const Cache_Config *config, unsigned num_cores)
+{
+    Coherence *coh = (Coherence *)calloc(1, sizeof(Coherence));
+    coh->num_cores = num_cores;
+    coh->mask_words = (num_cores + 63) / 64;
+    coh->blk_shift = log2u(config->block_size);
+
+    coh->caches = (Cache **)malloc(num_cores * sizeof(Cache *));
+    coh->cores = (Core_Stats *)calloc(num_cores, sizeof(Core_Stats));
+
+    unsigned i;
+    for (i = 0; i < num_cores; i++)
+    {
+        coh->caches[i] = initCacheFromConfig(config);
+        coh->caches[i]->coherence = coh;
+        coh->caches[i]->core = i;
+    }
+
+    allocDirectory(coh, DIRECTORY_SLOTS);
+    coh->lost_blocks = (Released_Block *)malloc(COHERENCE_LOST_BLOCKS * sizeof(Released_Block));
+    for (i = 0; i < COHERENCE_LOST_BLOCKS; i++)
+    {
+        coh->lost_blocks[i].blk_addr = DIRECTORY_EMPTY;
+    }
+    coh->event_sketch = initSpaceSaving(COHERENCE_TRACKED_BLOCKS);
+    coh->tracked = (Block_Events *)calloc(COHERENCE_TRACKED_BLOCKS, sizeof(Block_Events));
+
+    return coh;
+}
+
+void freeCoherence(Coherence *coh)
+{
+    unsigned i;
+    for (i = 0; i < coh->num_cores; i++)
+    {
+        freeCache(coh->caches[i]);
+    }
+    free(coh->caches);
+    free(coh->cores);
+    free(coh->entries);
+    free(coh->masks);
+    free(coh->lost_blocks);
+    freeSpaceSaving(coh->event_sketch);
+    free(coh->tracked);
+    free(coh);
+}
+
+bool coherentAccess(Coherence *coh, Request *req, uint64_t access_time)
+{
+    unsigned core = (unsigned)req->core_id % coh->num_cores;
+    Cache *cache = coh->caches[core];
+
+    if (accessBlock(cache, req, access_time))
+    {
+        ++coh->cores[core].hits;
+        return true;
+    }
+
+    ++coh->cores[core].misses;
+    uint64_t wb_addr;
+    insertBlock(cache, req, access_time, &wb_addr);
+    return false;
+}
+
+// The core's copy of blk_addr, which the directory says it holds
+static Cache_Block *coreBlock(Coherence *coh, unsigned core, uint64_t blk_addr)
+{
+    Cache_Block *blk = findBlock(coh->caches[core], blk_addr);
+    assert(blk != NULL);
+    return blk;
+}
+
+// Invalidate every copy but the writer's. Their data, dirty or not, goes
+// to the writer, so nothing is written back.
+static void invalidateOthers(Coherence *coh, uint64_t slot, unsigned writer, Request *req)
+{
+    Directory_Entry *entry = &(coh->entries[slot]);
+    uint64_t *sharer_mask = sharers(coh, slot);
+    uint64_t *lost_mask = lost(coh, slot);
+
+    uint64_t stored = chunkMask(coh->caches[writer], req->load_or_store_addr, accessBytes(req));
+    bool others = false;
+
+    unsigned w;
+    for (w = 0; w < coh->mask_words; w++)
+    {
+        uint64_t copies = sharer_mask[w];
+        while (copies != 0)
+        {
+            unsigned core = w * 64 + __builtin_ctzll(copies);
+            copies &= copies - 1;
+            if (core == writer)
+            {
+                continue;
+            }
+            others = true;
+
+            Cache_Block *blk = coreBlock(coh, core, entry->blk_addr);
+            blk->tag = UINTMAX_MAX;
+            blk->valid = false;
+            blk->dirty = false;
+            blk->exclusive = false;
+            blk->frequency = 0;
+            blk->when_touched = 0;
+            if (coh->caches[core]->tag_index != NULL)
+            {
+                unindexBlock(coh->caches[core], blk, entry->blk_addr);
+            }
+
+            clearBit(sharer_mask, core);
+            setBit(lost_mask, core);
+            ++coh->cores[core].invalidated;
+            ++blockEvent(coh, entry->blk_addr)->invalidations;
+            ++coh->invalidations;
+        }
+    }
+    entry->exclusive = false;
+
+    // Invalidating copies opens a new false sharing window, later stores
+    // that find no copy extend it
+    entry->write_mask = others ? stored : entry->write_mask | stored;
+}
+
+bool coherenceMiss(Coherence *coh, unsigned core, Request *req, bool allocate)
+{
+    uint64_t blk_addr = blkAlign(req->load_or_store_addr, coh->caches[core]->blk_mask);
+    int64_t slot = findEntry(coh, blk_addr, true);
+    Directory_Entry *entry = &(coh->entries[slot]);
+    uint64_t *sharer_mask = sharers(coh, slot);
+    uint64_t *lost_mask = lost(coh, slot);
+
+    // Coherence miss: this core's copy was invalidated by another core
+    if (testBit(lost_mask, core))
+    {
+        clearBit(lost_mask, core);
+        ++coh->cores[core].coherence_misses;
+        ++coh->coherence_misses;
+        Block_Events *events = blockEvent(coh, blk_addr);
+        ++events->coherence_misses;
+
+        uint64_t touched = chunkMask(coh->caches[core], req->load_or_store_addr, accessBytes(req));
+        if ((touched & entry->write_mask) == 0)
+        {
+            ++events->false_sharing;
+            ++coh->false_sharing;
+        }
+    }
+
+    bool exclusive;
+    if (req->req_type == STORE)
+    {
+        invalidateOthers(coh, slot, core, req);
+        exclusive = true;
+    }
+    else if (entry->exclusive)
+    {
+        // The owner's E or M copy becomes S, an M copy is written back
+        unsigned owner = 0;
+        while (!testBit(sharer_mask, owner))
+        {
+            ++owner;
+        }
+
+        Cache *owner_cache = coh->caches[owner];
+        Cache_Block *blk = coreBlock(coh, owner, blk_addr);
+        if (blk->dirty)
+        {
+            owner_cache->now = coh->caches[core]->now;
+            ++owner_cache->num_writebacks;
+            bufferWrite(owner_cache, blk_addr, owner_cache->blk_mask + 1);
+            blk->dirty = false;
+        }
+        blk->exclusive = false;
+
+        entry->exclusive = false;
+        ++blockEvent(coh, blk_addr)->downgrades;
+        ++coh->downgrades;
+        exclusive = false;
+    }
+    else
+    {
+        exclusive = emptyMask(sharer_mask, coh->mask_words);
+    }
+
+    if (allocate)
+    {
+        setBit(sharer_mask, core);
+        entry->exclusive = exclusive;
+    }
+    else
+    {
+        releaseEntry(coh, slot);
+    }
+
+    return exclusive;
+}
+
+void coherenceUpgrade(Coherence *coh, unsigned core, Request *req)
+{
+    uint64_t blk_addr = blkAlign(req->load_or_store_addr, coh->caches[core]->blk_mask);
+    int64_t slot = findEntry(coh, blk_addr, false);
+    assert(slot >= 0);
+
+    invalidateOthers(coh, slot, core, req);
+    coh->entries[slot].exclusive = true;
+    ++coh->upgrades;
+}
+
+void coherenceEvict(Coherence *coh, unsigned core, uint64_t blk_addr)
+{
+    int64_t slot = findEntry(coh, blk_addr, false);
+    assert(slot >= 0);
+
+    clearBit(sharers(coh, slot), core);
+    coh->entries[slot].exclusive = false;
+    releaseEntry(coh, slot);
+}
+
+/* Report */
+typedef struct Block_Row
+{
+    uint64_t blk_addr;
+    uint64_t events;
+    uint64_t error;
+    const Block_Events *counts;
+}Block_Row;
+
+static int compareBlocks(const void *a, const void *b)
+{
+    const Block_Row *x = (const Block_Row *)a;
+    const Block_Row *y = (const Block_Row *)b;
+
+    if (x->counts->false_sharing != y->counts->false_sharing)
+    {
+        return x->counts->false_sharing < y->counts->false_sharing ? 1 : -1;
+    }
+    if (x->events != y->events)
+    {
+        return x->events < y->events ? 1 : -1;
+    }
+    return x->blk_addr < y->blk_addr ? -1 : x->blk_addr > y->blk_addr;
+}
+
+void printCoherenceReport(Coherence *coh)
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    unsigned i;
+    for (i = 0; i < coh->num_cores; i++)
+    {
+        hits += coh->cores[i].hits;
+        misses += coh->cores[i].misses;
+    }
+
+    printf("Hit rate: %lf%%\n", hits + misses ? 100.0 * hits / (hits + misses) : 0);
+    printf("%-6s %12s %12s %12s %12s %12s\n", "Core", "Requests", "Hit rate", "Misses",
+           "Coherence", "Invalidated");
+    for (i = 0; i < coh->num_cores; i++)
+    {
+        Core_Stats *core = &(coh->cores[i]);
+        uint64_t requests = core->hits + core->misses;
+        if (requests == 0)
+        {
+            continue;
+        }
+        printf("%-6u %12"PRIu64" %11.4f%% %12"PRIu64" %12"PRIu64" %12"PRIu64"\n", i, requests,
+               100.0 * core->hits / requests, core->misses, core->coherence_misses,
+               core->invalidated);
+    }
+
+    printf("Invalidations: %"PRIu64", Downgrades: %"PRIu64", Upgrades: %"PRIu64"\n",
+           coh->invalidations, coh->downgrades, coh->upgrades);
+    printf("Coherence misses: %"PRIu64" (%"PRIu64" false sharing)\n",
+           coh->coherence_misses, coh->false_sharing);
+
+    // Blocks with the most false sharing, then the most coherence traffic
+    const Space_Saving *sketch = coh->event_sketch;
+    Block_Row *blocks = (Block_Row *)malloc((sketch->num_used + 1) * sizeof(Block_Row));
+    unsigned j;
+    for (j = 0; j < sketch->num_used; j++)
+    {
+        blocks[j].blk_addr = sketch->keys[j];
+        blocks[j].events = sketch->counts[j];
+        blocks[j].error = sketch->errors[j];
+        blocks[j].counts = &(coh->tracked[j]);
+    }
+    qsort(blocks, sketch->num_used, sizeof(Block_Row), compareBlocks);
+
+    if (sketch->num_used > 0)
+    {
+        printf("%-18s %12s %8s %12s %12s %12s %12s\n", "Block", "Events", "(+/-)",
+               "Invalidated", "Downgraded", "Coherence", "False share");
+    }
+    for (j = 0; j < sketch->num_used && j < COHERENCE_TOP_BLOCKS; j++)
+    {
+        const Block_Events *counts = blocks[j].counts;
+        printf("0x%-16"PRIx64" %12"PRIu64" %8"PRIu64" %12u %12u %12u %12u\n",
+               blocks[j].blk_addr, blocks[j].events, blocks[j].error, counts->invalidations,
+               counts->downgrades, counts->coherence_misses, counts->false_sharing);
+    }
+    free(blocks);
+}
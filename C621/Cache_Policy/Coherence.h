@@ -0,0 +1,124 @@
+#ifndef __COHERENCE_H__
+#define __COHERENCE_H__
+
+#include "Cache.h"
+#include "Space_Saving.h"
+
+// MESI coherence between per-core private caches, kept by a full-map
+// directory. Request::core_id picks the private cache (modulo the number
+// of cores).
+//
+// A block's state in a private cache is Cache_Block::valid, ::dirty and
+// ::exclusive: M is dirty, E exclusive and clean, S shared. Load hits and
+// store hits in E or M never reach the directory; only misses, stores to
+// S copies (upgrades) and evictions do.
+//
+// The directory is an open-addressing hash of the blocks some core holds.
+// Each entry carries a sharer bitmask and a lost bitmask (cores whose copy
+// was invalidated and not fetched again), one bit per core in
+// ceil(num_cores / 64) words. An entry goes away once no core holds the
+// block, unless its lost mask is not empty: then it stays while it is one
+// of the COHERENCE_LOST_BLOCKS most recently released, so the directory
+// never has more entries than the private caches have blocks plus
+// COHERENCE_LOST_BLOCKS. A no-write-allocate store miss releases the block
+// as soon as it has invalidated the other copies.
+//
+// A miss by a core in the lost mask is a coherence miss. It is false
+// sharing if it touches none of the bytes stored by the last writer that
+// invalidated copies. Only stores that reach the directory count, store
+// hits in M stay private. A miss on a block whose lost mask is gone is a
+// plain miss.
+//
+// Per-block event counts for the report live apart from the directory, in
+// a space-saving sketch (see Space_Saving.h) of COHERENCE_TRACKED_BLOCKS
+// slots: the blocks with the most invalidations, downgrades and coherence
+// misses, whatever the number of blocks that ever had one.
+#define DIRECTORY_EMPTY UINT64_MAX
+#define COHERENCE_MAX_CORES 4096
+#define COHERENCE_TOP_BLOCKS 10 // Blocks listed in the report
+#define COHERENCE_TRACKED_BLOCKS (64 * COHERENCE_TOP_BLOCKS)
+#define COHERENCE_LOST_BLOCKS 4096 // Released blocks that keep their lost mask
+
+typedef struct Directory_Entry
+{
+    uint64_t blk_addr; // DIRECTORY_EMPTY for a free slot
+    uint64_t write_mask; // Chunks stored by the last invalidating writer
+    uint64_t released; // Coherence::releases when nobody held it last, 0 if never
+
+    bool exclusive; // The only sharer holds it in E or M
+}Directory_Entry;
+
+typedef struct Released_Block
+{
+    uint64_t blk_addr; // DIRECTORY_EMPTY for a free slot
+    uint64_t released; // Matches the entry's while it is still released
+}Released_Block;
+
+typedef struct Block_Events
+{
+    // Since the block got its sketch slot
+    uint32_t invalidations; // Copies invalidated
+    uint32_t downgrades; // E or M copies downgraded to S
+    uint32_t coherence_misses;
+    uint32_t false_sharing; // Coherence misses on bytes nobody else stored
+}Block_Events;
+
+typedef struct Core_Stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t coherence_misses;
+    uint64_t invalidated; // Copies this core lost to other cores' stores
+}Core_Stats;
+
+typedef struct Coherence
+{
+    unsigned num_cores;
+    Cache **caches; // Private cache per core
+    Core_Stats *cores;
+
+    // Directory
+    Directory_Entry *entries;
+    uint64_t *masks; // Per slot: sharers[mask_words], then lost[mask_words]
+    unsigned mask_words;
+    uint64_t capacity; // Slots, a power of two
+    uint64_t num_entries;
+    unsigned hash_shift;
+    unsigned blk_shift;
+
+    // Released entries that keep their lost mask, oldest at lost_next
+    Released_Block *lost_blocks; // COHERENCE_LOST_BLOCKS, a ring
+    unsigned lost_next;
+    uint64_t releases;
+
+    // Blocks with the most coherence events
+    Space_Saving *event_sketch; // Block address to events
+    Block_Events *tracked; // Per sketch slot
+
+    uint64_t invalidations;
+    uint64_t downgrades;
+    uint64_t upgrades; // Stores to S copies
+    uint64_t coherence_misses;
+    uint64_t false_sharing;
+}Coherence;
+
+// num_cores (1 to COHERENCE_MAX_CORES) private caches built from config
+Coherence *initCoherence(const Cache_Config *config, unsigned num_cores);
+void freeCoherence(Coherence *coh);
+
+// One request on its core's cache, filling it on a miss. Returns true on a hit.
+bool coherentAccess(Coherence *coh, Request *req, uint64_t access_time);
+
+// Hooks for Cache.c, see Cache::coherence
+// A miss by core: invalidates or downgrades the other copies and returns
+// true if the core gets the block exclusively. A no-write-allocate store
+// passes allocate = false and does not become a sharer.
+bool coherenceMiss(Coherence *coh, unsigned core, Request *req, bool allocate);
+// A store hit on an S copy, the other copies are invalidated
+void coherenceUpgrade(Coherence *coh, unsigned core, Request *req);
+// core evicted blk_addr
+void coherenceEvict(Coherence *coh, unsigned core, uint64_t blk_addr);
+
+void printCoherenceReport(Coherence *coh);
+
+#endif
@@ -0,0 +1,432 @@
+#include "DRAM.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+/* Defaults, DDR4-2400 */
+static const unsigned dram_channels = 1;
+static const unsigned dram_ranks = 2;
+static const unsigned dram_banks = 16;
+static const unsigned dram_row_bytes = 8192;
+static const unsigned dram_queue_depth = 32;
+
+static const unsigned dram_tCL = 17;
+static const unsigned dram_tCWL = 12;
+static const unsigned dram_tRCD = 17;
+static const unsigned dram_tRP = 17;
+static const unsigned dram_tRAS = 39;
+static const unsigned dram_tWR = 18;
+static const unsigned dram_tBURST = 4; // BL8 on a double data rate bus
+
+static const double dram_tCK_ns = 0.833;
+// A trace request every 4 DRAM cycles (~3.3ns), about one per 10 core cycles
+static const double dram_time_scale = 4;
+
+static unsigned log2u(uint64_t x)
+{
+    unsigned bits = 0;
+    while (x > 1)
+    {
+        x >>= 1;
+        ++bits;
+    }
+    return bits;
+}
+
+void initDRAMConfig(DRAM_Config *config, unsigned block_bytes)
+{
+    config->channels = dram_channels;
+    config->ranks = dram_ranks;
+    config->banks = dram_banks;
+    config->row_bytes = dram_row_bytes;
+    config->block_bytes = block_bytes;
+    config->queue_depth = dram_queue_depth;
+
+    config->tCL = dram_tCL;
+    config->tCWL = dram_tCWL;
+    config->tRCD = dram_tRCD;
+    config->tRP = dram_tRP;
+    config->tRAS = dram_tRAS;
+    config->tWR = dram_tWR;
+    config->tBURST = dram_tBURST;
+
+    config->tCK_ns = dram_tCK_ns;
+    config->time_scale = dram_time_scale;
+}
+
+bool parseDRAMConfig(const char *spec, DRAM_Config *config)
+{
+    unsigned fields[3] = {config->channels, config->ranks, config->banks};
+
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        char *end;
+        long value = strtol(spec, &end, 10);
+        if (end == spec || value <= 0)
+        {
+            return false;
+        }
+        fields[i] = value;
+
+        if (*end == '\0')
+        {
+            break;
+        }
+        if (*end != ':' || i == 2)
+        {
+            return false;
+        }
+        spec = end + 1;
+    }
+
+    config->channels = fields[0];
+    config->ranks = fields[1];
+    config->banks = fields[2];
+    return true;
+}
+
+DRAM *initDRAM(const DRAM_Config *config)
+{
+    if (config->block_bytes > config->row_bytes)
+    {
+        fprintf(stderr, "%uB blocks do not fit in %uB DRAM rows\n", config->block_bytes,
+                config->row_bytes);
+        return NULL;
+    }
+
+    DRAM *dram = (DRAM *)calloc(1, sizeof(DRAM));
+    dram->config = *config;
+
+    dram->blk_shift = log2u(config->block_bytes);
+    dram->column_bits = log2u(config->row_bytes / config->block_bytes);
+    unsigned bursts = (config->block_bytes + DRAM_BURST_BYTES - 1) / DRAM_BURST_BYTES;
+    dram->block_cycles = bursts * config->tBURST;
+
+    dram->channels = (DRAM_Channel *)calloc(config->channels, sizeof(DRAM_Channel));
+    unsigned i, j;
+    for (i = 0; i < config->channels; i++)
+    {
+        DRAM_Channel *channel = &(dram->channels[i]);
+
+        channel->banks = (DRAM_Bank *)calloc(config->ranks * config->banks, sizeof(DRAM_Bank));
+        for (j = 0; j < config->ranks * config->banks; j++)
+        {
+            channel->banks[j].open_row = -1;
+        }
+
+        channel->queue = (DRAM_Request *)malloc(config->queue_depth * sizeof(DRAM_Request));
+        channel->wakeup = UINT64_MAX;
+    }
+
+    dram->max_events = 2 * config->channels + 16;
+    dram->events = (DRAM_Event *)malloc(dram->max_events * sizeof(DRAM_Event));
+
+    return dram;
+}
+
+void freeDRAM(DRAM *dram)
+{
+    unsigned i;
+    for (i = 0; i < dram->config.channels; i++)
+    {
+        free(dram->channels[i].banks);
+        free(dram->channels[i].queue);
+    }
+    free(dram->channels);
+    free(dram->events);
+    free(dram);
+}
+
+/* Event queue */
+static void pushEvent(DRAM *dram, uint64_t time, unsigned channel)
+{
+    if (dram->num_events == dram->max_events)
+    {
+        dram->max_events *= 2;
+        dram->events = (DRAM_Event *)realloc(dram->events, dram->max_events * sizeof(DRAM_Event));
+    }
+
+    // Sift up
+    unsigned i = dram->num_events++;
+    while (i > 0 && dram->events[(i - 1) / 2].time > time)
+    {
+        dram->events[i] = dram->events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    dram->events[i].time = time;
+    dram->events[i].channel = channel;
+}
+
+static DRAM_Event popEvent(DRAM *dram)
+{
+    DRAM_Event top = dram->events[0];
+    DRAM_Event last = dram->events[--dram->num_events];
+
+    // Sift down
+    unsigned i = 0;
+    while (2 * i + 1 < dram->num_events)
+    {
+        unsigned child = 2 * i + 1;
+        if (child + 1 < dram->num_events && dram->events[child + 1].time < dram->events[child].time)
+        {
+            ++child;
+        }
+        if (dram->events[child].time >= last.time)
+        {
+            break;
+        }
+        dram->events[i] = dram->events[child];
+        i = child;
+    }
+    dram->events[i] = last;
+
+    return top;
+}
+
+// Run the channel's scheduler at time, unless it already runs earlier.
+// A later pending event stays in the heap and is dropped as stale.
+static void wakeChannel(DRAM *dram, unsigned channel, uint64_t time)
+{
+    if (time < dram->channels[channel].wakeup)
+    {
+        dram->channels[channel].wakeup = time;
+        pushEvent(dram, time, channel);
+    }
+}
+
+/* Scheduling */
+static inline DRAM_Bank *requestBank(DRAM *dram, DRAM_Channel *channel, DRAM_Request *req)
+{
+    return &(channel->banks[req->rank * dram->config.banks + req->bank]);
+}
+
+// Earliest cycle the request's first command (CAS, ACT or PRE) can issue
+static inline uint64_t readyTime(DRAM_Bank *bank, DRAM_Request *req)
+{
+    if (bank->open_row == (int64_t)req->row)
+    {
+        return bank->next_cas;
+    }
+    return bank->open_row < 0 ? 0 : bank->next_pre;
+}
+
+// Issue every command of req from time on and account for its completion
+static void issueRequest(DRAM *dram, DRAM_Channel *channel, DRAM_Request *req, uint64_t time)
+{
+    const DRAM_Config *config = &(dram->config);
+    DRAM_Bank *bank = requestBank(dram, channel, req);
+
+    uint64_t cas;
+    if (bank->open_row == (int64_t)req->row)
+    {
+        ++dram->row_hits;
+        cas = time;
+    }
+    else
+    {
+        uint64_t act = time;
+        if (bank->open_row < 0)
+        {
+            ++dram->row_empties;
+        }
+        else
+        {
+            ++dram->row_conflicts;
+            act += config->tRP;
+        }
+
+        cas = act + config->tRCD;
+        bank->open_row = req->row;
+        bank->next_pre = act + config->tRAS;
+    }
+
+    // The data burst waits for the channel's bus
+    uint64_t data = cas + (req->is_write ? config->tCWL : config->tCL);
+    if (data < channel->bus_free)
+    {
+        data = channel->bus_free;
+    }
+    uint64_t done = data + dram->block_cycles;
+    channel->bus_free = done;
+    dram->bus_busy += dram->block_cycles;
+
+    bank->next_cas = cas + dram->block_cycles;
+    if (req->is_write)
+    {
+        if (bank->next_pre < done + config->tWR)
+        {
+            bank->next_pre = done + config->tWR;
+        }
+        dram->write_latency += done - req->arrival;
+    }
+    else
+    {
+        dram->read_latency += done - req->arrival;
+    }
+
+    if (done > dram->last_done)
+    {
+        dram->last_done = done;
+    }
+}
+
+// FR-FCFS: the oldest row hit that can issue now, else the oldest request
+// that can. One command slot per cycle.
+static void scheduleChannel(DRAM *dram, unsigned channel_idx, uint64_t time)
+{
+    DRAM_Channel *channel = &(dram->channels[channel_idx]);
+    if (channel->queue_len == 0)
+    {
+        return;
+    }
+
+    int best = -1;
+    bool best_hit = false;
+    uint64_t earliest = UINT64_MAX;
+
+    unsigned i;
+    for (i = 0; i < channel->queue_len; i++)
+    {
+        DRAM_Request *req = &(channel->queue[i]);
+        DRAM_Bank *bank = requestBank(dram, channel, req);
+
+        uint64_t ready = readyTime(bank, req);
+        if (ready > time)
+        {
+            if (ready < earliest)
+            {
+                earliest = ready;
+            }
+            continue;
+        }
+
+        bool hit = bank->open_row == (int64_t)req->row;
+        if (best < 0 || (hit && !best_hit) ||
+            (hit == best_hit && req->seq < channel->queue[best].seq))
+        {
+            best = i;
+            best_hit = hit;
+        }
+    }
+
+    if (best < 0)
+    {
+        wakeChannel(dram, channel_idx, earliest);
+        return;
+    }
+
+    issueRequest(dram, channel, &(channel->queue[best]), time);
+    channel->queue[best] = channel->queue[--channel->queue_len];
+
+    if (channel->queue_len > 0)
+    {
+        wakeChannel(dram, channel_idx, time + 1);
+    }
+}
+
+static void runEvent(DRAM *dram)
+{
+    DRAM_Event event = popEvent(dram);
+    DRAM_Channel *channel = &(dram->channels[event.channel]);
+
+    if (event.time != channel->wakeup)
+    {
+        return; // Superseded by an earlier wakeup
+    }
+    channel->wakeup = UINT64_MAX;
+
+    dram->now = event.time;
+    scheduleChannel(dram, event.channel, event.time);
+}
+
+void accessDRAM(DRAM *dram, uint64_t addr, bool is_write, uint64_t time)
+{
+    const DRAM_Config *config = &(dram->config);
+
+    uint64_t arrival = (uint64_t)(time * config->time_scale);
+    if (arrival < dram->now)
+    {
+        arrival = dram->now; // Timestamps from before the last event
+    }
+
+    // Everything before the arrival happens first
+    while (dram->num_events > 0 && dram->events[0].time < arrival)
+    {
+        runEvent(dram);
+    }
+
+    // row:rank:bank:column:channel
+    uint64_t x = addr >> dram->blk_shift;
+    unsigned channel_idx = x % config->channels;
+    x = (x / config->channels) >> dram->column_bits;
+
+    DRAM_Request req;
+    req.arrival = arrival;
+    req.seq = dram->seq++;
+    req.bank = x % config->banks;
+    x /= config->banks;
+    req.rank = x % config->ranks;
+    req.row = x / config->ranks;
+    req.is_write = is_write;
+
+    // A full queue stalls the arrival until the scheduler frees a slot
+    DRAM_Channel *channel = &(dram->channels[channel_idx]);
+    while (channel->queue_len == config->queue_depth)
+    {
+        runEvent(dram);
+    }
+    channel->queue[channel->queue_len++] = req;
+
+    if (dram->reads + dram->writes == 0)
+    {
+        dram->first_arrival = arrival;
+    }
+    if (is_write)
+    {
+        ++dram->writes;
+    }
+    else
+    {
+        ++dram->reads;
+    }
+
+    wakeChannel(dram, channel_idx, arrival > dram->now ? arrival : dram->now);
+}
+
+void drainDRAM(DRAM *dram)
+{
+    while (dram->num_events > 0)
+    {
+        runEvent(dram);
+    }
+}
+
+void printDRAMStats(DRAM *dram)
+{
+    const DRAM_Config *config = &(dram->config);
+
+    uint64_t requests = dram->reads + dram->writes;
+    uint64_t issued = dram->row_hits + dram->row_empties + dram->row_conflicts;
+    uint64_t elapsed = dram->last_done - dram->first_arrival;
+
+    double read_latency = dram->reads ? (double)dram->read_latency / dram->reads : 0;
+    double write_latency = dram->writes ? (double)dram->write_latency / dram->writes : 0;
+    double bytes_per_cycle = elapsed ? (double)requests * config->block_bytes / elapsed : 0;
+
+    printf("DRAM: %u channel(s) x %u rank(s) x %u bank(s), %uB rows\n",
+           config->channels, config->ranks, config->banks, config->row_bytes);
+    printf("DRAM requests: %"PRIu64" reads, %"PRIu64" writes\n", dram->reads, dram->writes);
+    printf("Row buffer: %"PRIu64" hits (%.2f%%), %"PRIu64" empty, %"PRIu64" conflicts (%.2f%%)\n",
+           dram->row_hits, issued ? 100.0 * dram->row_hits / issued : 0, dram->row_empties,
+           dram->row_conflicts, issued ? 100.0 * dram->row_conflicts / issued : 0);
+    printf("Average DRAM latency: %.2f cycles (%.2fns) read, %.2f cycles write\n",
+           read_latency, read_latency * config->tCK_ns, write_latency);
+    printf("DRAM bandwidth: %.3f GB/s (%.2f bytes/cycle), data bus %.2f%% busy\n",
+           bytes_per_cycle / config->tCK_ns, bytes_per_cycle,
+           elapsed ? 100.0 * dram->bus_busy / ((double)elapsed * config->channels) : 0);
+}
@@ -0,0 +1,122 @@
+#ifndef __DRAM_H__
+#define __DRAM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Event-driven DRAM backend behind the cache's fills and writebacks.
+//
+// Addresses map block-interleaved as row:rank:bank:column:channel, so
+// consecutive blocks spread over the channels and then stay in one open
+// row. Each channel has its own request queue, banks with an open row
+// buffer, and a data bus. The scheduler is FR-FCFS: among the requests
+// whose next command can issue, row-buffer hits go first, then the oldest.
+//
+// Nothing is ticked per cycle. Requests arrive in timestamp order, and a
+// channel's scheduler only runs at the events that can change its
+// decision (an arrival, a bank becoming ready, the command bus freeing),
+// kept in a min-heap, so the cost scales with memory requests.
+//
+// All timing parameters are in DRAM clock cycles.
+#define DRAM_BURST_BYTES 64 // BL8 on a 64-bit bus, a block moves in ceil(block / 64) bursts
+
+typedef struct DRAM_Config
+{
+    unsigned channels;
+    unsigned ranks; // Per channel
+    unsigned banks; // Per rank
+    unsigned row_bytes; // Row buffer size per bank
+    unsigned block_bytes; // The cache block size, at most row_bytes
+    unsigned queue_depth; // Requests per channel queue, arrivals stall when full
+
+    unsigned tCL;   // Read CAS latency
+    unsigned tCWL;  // Write CAS latency
+    unsigned tRCD;  // Activate to column command
+    unsigned tRP;   // Precharge
+    unsigned tRAS;  // Activate to precharge
+    unsigned tWR;   // End of write data to precharge
+    unsigned tBURST; // Data bus cycles per DRAM_BURST_BYTES burst
+
+    double tCK_ns; // DRAM clock period
+    double time_scale; // DRAM cycles per unit of the timestamps passed in
+}DRAM_Config;
+
+typedef struct DRAM_Request
+{
+    uint64_t arrival; // DRAM cycle
+    uint64_t seq; // Arrival order, for FCFS
+    uint32_t rank;
+    uint32_t bank;
+    uint64_t row;
+    bool is_write;
+}DRAM_Request;
+
+typedef struct DRAM_Bank
+{
+    int64_t open_row; // -1 when precharged, the bank can activate at once
+    uint64_t next_cas; // Earliest column command to the open row
+    uint64_t next_pre; // Earliest precharge (tRAS, write recovery)
+}DRAM_Bank;
+
+typedef struct DRAM_Channel
+{
+    DRAM_Bank *banks; // ranks x banks
+    DRAM_Request *queue; // Unordered, queue_depth entries
+    unsigned queue_len;
+
+    uint64_t bus_free; // Data bus free from this cycle on
+    uint64_t wakeup; // Pending scheduler event, UINT64_MAX if none
+}DRAM_Channel;
+
+typedef struct DRAM_Event
+{
+    uint64_t time;
+    unsigned channel;
+}DRAM_Event;
+
+typedef struct DRAM
+{
+    DRAM_Config config;
+    DRAM_Channel *channels;
+
+    DRAM_Event *events; // Min-heap on time
+    unsigned num_events;
+    unsigned max_events;
+
+    uint64_t now; // Time of the event being processed
+    uint64_t seq;
+
+    unsigned blk_shift;
+    unsigned column_bits; // log2(blocks per row)
+    unsigned block_cycles; // Data bus cycles per block
+
+    // Statistics
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t row_hits;
+    uint64_t row_empties; // Bank was precharged
+    uint64_t row_conflicts; // Another row was open
+    uint64_t read_latency; // Sum of arrival to last data beat
+    uint64_t write_latency;
+    uint64_t bus_busy; // Data bus cycles, over all channels
+    uint64_t first_arrival;
+    uint64_t last_done;
+}DRAM;
+
+// Defaults: one DDR4-2400 channel, 2 ranks of 16 banks, 8KB rows,
+// 17-17-17 timings, and 4 DRAM cycles between timestamps
+void initDRAMConfig(DRAM_Config *config, unsigned block_bytes);
+// Parse "<channels>[:<ranks>[:<banks>]]" into config, false if malformed
+bool parseDRAMConfig(const char *spec, DRAM_Config *config);
+// NULL, with a message, when a block does not fit in a row
+DRAM *initDRAM(const DRAM_Config *config);
+void freeDRAM(DRAM *dram);
+
+// A block read (fill) or write arriving at time (in timestamp units)
+void accessDRAM(DRAM *dram, uint64_t addr, bool is_write, uint64_t time);
+// Run until every queued request has completed
+void drainDRAM(DRAM *dram);
+
+void printDRAMStats(DRAM *dram);
+
+#endif
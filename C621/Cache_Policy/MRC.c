@@ -0,0 +1,394 @@
+#include "MRC.h"
+
+/* Defaults */
+const unsigned mrc_samples = 8192;
+const unsigned mrc_exact_kb[MRC_EXACT_SIZES] = {32, 256, 2048, 16384};
+
+static inline uint32_t hashBlock(uint64_t blk_addr)
+{
+    // MurmurHash3 finalizer, every address bit reaches the sampled bits
+    uint64_t h = blk_addr;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h & (MRC_HASH_MODULUS - 1);
+}
+
+MRC *initMRC(unsigned max_samples, unsigned block_size)
+{
+    // Each histogram bin must hold at least one block
+    if (block_size == 0 || (block_size & (block_size - 1)) != 0 ||
+        block_size > MRC_MIN_KB * 1024)
+    {
+        fprintf(stderr, "%uB blocks: the miss ratio curve needs a power of two up to %uKB\n",
+                block_size, MRC_MIN_KB);
+        return NULL;
+    }
+
+    MRC *mrc = (MRC *)calloc(1, sizeof(MRC));
+    mrc->blk_shift = log2(block_size);
+    mrc->max_samples = max_samples;
+    mrc->threshold = MRC_HASH_MODULUS;
+
+    unsigned num_slots = max_samples + 1;
+    mrc->samples = (MRC_Sample *)calloc(num_slots, sizeof(MRC_Sample));
+    mrc->free_slots = (unsigned *)malloc(num_slots * sizeof(unsigned));
+    unsigned i;
+    for (i = 0; i < num_slots; i++)
+    {
+        mrc->free_slots[i] = num_slots - 1 - i;
+    }
+    mrc->num_free = num_slots;
+    mrc->heap = (unsigned *)malloc(num_slots * sizeof(unsigned));
+
+    unsigned index_size = 1;
+    while (index_size < 2 * num_slots)
+    {
+        index_size <<= 1;
+    }
+    mrc->index_mask = index_size - 1;
+    mrc->index = (int *)malloc(index_size * sizeof(int));
+    memset(mrc->index, -1, index_size * sizeof(int));
+
+    mrc->num_stamps = 2 * num_slots;
+    mrc->fenwick = (uint32_t *)calloc(mrc->num_stamps + 1, sizeof(uint32_t));
+    mrc->stamp_owner = (int *)malloc(mrc->num_stamps * sizeof(int));
+    memset(mrc->stamp_owner, -1, mrc->num_stamps * sizeof(int));
+
+    mrc->bin_blocks = (uint64_t)MRC_MIN_KB * 1024 / block_size;
+    mrc->num_bins = MRC_MAX_KB / MRC_MIN_KB + 1;
+    mrc->histogram = (double *)calloc(mrc->num_bins, sizeof(double));
+
+    return mrc;
+}
+
+void freeMRC(MRC *mrc)
+{
+    free(mrc->samples);
+    free(mrc->free_slots);
+    free(mrc->heap);
+    free(mrc->index);
+    free(mrc->fenwick);
+    free(mrc->stamp_owner);
+    free(mrc->histogram);
+    free(mrc);
+}
+
+size_t mrcMemory(const MRC *mrc)
+{
+    unsigned num_slots = mrc->max_samples + 1;
+    return sizeof(MRC) + num_slots * (sizeof(MRC_Sample) + 2 * sizeof(unsigned)) +
+           (mrc->index_mask + 1) * sizeof(int) +
+           (mrc->num_stamps + 1) * sizeof(uint32_t) + mrc->num_stamps * sizeof(int) +
+           mrc->num_bins * sizeof(double);
+}
+
+/* Block index */
+static int findSample(MRC *mrc, uint64_t blk_addr, uint32_t hash)
+{
+    unsigned pos = hash & mrc->index_mask;
+    while (mrc->index[pos] >= 0)
+    {
+        if (mrc->samples[mrc->index[pos]].blk_addr == blk_addr)
+        {
+            return mrc->index[pos];
+        }
+        pos = (pos + 1) & mrc->index_mask;
+    }
+    return -1;
+}
+
+static void indexSample(MRC *mrc, unsigned slot)
+{
+    unsigned pos = mrc->samples[slot].hash & mrc->index_mask;
+    while (mrc->index[pos] >= 0)
+    {
+        pos = (pos + 1) & mrc->index_mask;
+    }
+    mrc->index[pos] = slot;
+}
+
+// Later entries of the probe run shift back into the hole
+static void unindexSample(MRC *mrc, unsigned slot)
+{
+    unsigned hole = mrc->samples[slot].hash & mrc->index_mask;
+    while (mrc->index[hole] != slot)
+    {
+        hole = (hole + 1) & mrc->index_mask;
+    }
+
+    unsigned next = (hole + 1) & mrc->index_mask;
+    while (mrc->index[next] >= 0)
+    {
+        unsigned home = mrc->samples[mrc->index[next]].hash & mrc->index_mask;
+        if (((next - home) & mrc->index_mask) >= ((next - hole) & mrc->index_mask))
+        {
+            mrc->index[hole] = mrc->index[next];
+            hole = next;
+        }
+        next = (next + 1) & mrc->index_mask;
+    }
+    mrc->index[hole] = -1;
+}
+
+/* Max-heap on hash */
+static inline uint32_t heapKey(MRC *mrc, unsigned pos)
+{
+    return mrc->samples[mrc->heap[pos]].hash;
+}
+
+static void heapPush(MRC *mrc, unsigned slot)
+{
+    unsigned pos = mrc->num_samples++;
+    mrc->heap[pos] = slot;
+    while (pos > 0 && heapKey(mrc, (pos - 1) / 2) < heapKey(mrc, pos))
+    {
+        unsigned parent = (pos - 1) / 2;
+        mrc->heap[pos] = mrc->heap[parent];
+        mrc->heap[parent] = slot;
+        pos = parent;
+    }
+}
+
+static unsigned heapPop(MRC *mrc)
+{
+    unsigned top = mrc->heap[0];
+    unsigned slot = mrc->heap[--mrc->num_samples];
+
+    unsigned pos = 0;
+    mrc->heap[0] = slot;
+    while (2 * pos + 1 < mrc->num_samples)
+    {
+        unsigned child = 2 * pos + 1;
+        if (child + 1 < mrc->num_samples && heapKey(mrc, child + 1) > heapKey(mrc, child))
+        {
+            ++child;
+        }
+        if (heapKey(mrc, pos) >= heapKey(mrc, child))
+        {
+            break;
+        }
+        mrc->heap[pos] = mrc->heap[child];
+        mrc->heap[child] = slot;
+        pos = child;
+    }
+
+    return top;
+}
+
+/* Recency */
+static void fenwickAdd(MRC *mrc, uint32_t stamp, int delta)
+{
+    uint32_t i;
+    for (i = stamp + 1; i <= mrc->num_stamps; i += i & -i)
+    {
+        mrc->fenwick[i] += delta;
+    }
+}
+
+// Live stamps at or below stamp
+static uint32_t fenwickCount(MRC *mrc, uint32_t stamp)
+{
+    uint32_t count = 0;
+    uint32_t i;
+    for (i = stamp + 1; i > 0; i -= i & -i)
+    {
+        count += mrc->fenwick[i];
+    }
+    return count;
+}
+
+// Renumber the live stamps 0..num_samples - 1 in order and rebuild the tree
+static void compactStamps(MRC *mrc)
+{
+    uint32_t next = 0;
+    uint32_t stamp;
+    for (stamp = 0; stamp < mrc->clock; stamp++)
+    {
+        int slot = mrc->stamp_owner[stamp];
+        if (slot >= 0)
+        {
+            mrc->stamp_owner[stamp] = -1;
+            mrc->stamp_owner[next] = slot;
+            mrc->samples[slot].stamp = next++;
+        }
+    }
+    mrc->clock = next;
+
+    memset(mrc->fenwick, 0, (mrc->num_stamps + 1) * sizeof(uint32_t));
+    uint32_t i;
+    for (i = 1; i <= mrc->num_stamps; i++)
+    {
+        mrc->fenwick[i] += i <= next;
+        uint32_t parent = i + (i & -i);
+        if (parent <= mrc->num_stamps)
+        {
+            mrc->fenwick[parent] += mrc->fenwick[i];
+        }
+    }
+}
+
+static void stampSample(MRC *mrc, unsigned slot)
+{
+    if (mrc->clock == mrc->num_stamps)
+    {
+        compactStamps(mrc);
+    }
+    mrc->samples[slot].stamp = mrc->clock;
+    mrc->stamp_owner[mrc->clock] = slot;
+    fenwickAdd(mrc, mrc->clock, 1);
+    ++mrc->clock;
+}
+
+static void unstampSample(MRC *mrc, unsigned slot)
+{
+    mrc->stamp_owner[mrc->samples[slot].stamp] = -1;
+    fenwickAdd(mrc, mrc->samples[slot].stamp, -1);
+}
+
+/* Sampling */
+void mrcAccess(MRC *mrc, uint64_t addr)
+{
+    ++mrc->references;
+
+    uint64_t blk_addr = blkAlign(addr, (1ULL << mrc->blk_shift) - 1);
+    uint32_t hash = hashBlock(blk_addr >> mrc->blk_shift);
+    if (hash >= mrc->threshold)
+    {
+        return;
+    }
+    ++mrc->sampled;
+
+    double rate = (double)mrc->threshold / MRC_HASH_MODULUS;
+    int slot = findSample(mrc, blk_addr, hash);
+    if (slot >= 0)
+    {
+        uint32_t distance = mrc->num_samples - fenwickCount(mrc, mrc->samples[slot].stamp);
+        uint64_t bin = (uint64_t)(distance / rate) / mrc->bin_blocks;
+        mrc->histogram[bin < mrc->num_bins - 1 ? bin : mrc->num_bins - 1] += 1 / rate;
+
+        unstampSample(mrc, slot);
+        stampSample(mrc, slot);
+        return;
+    }
+
+    // Cold miss, the block joins the sample set
+    mrc->histogram[mrc->num_bins - 1] += 1 / rate;
+    ++mrc->blocks_sampled;
+
+    slot = mrc->free_slots[--mrc->num_free];
+    mrc->samples[slot].blk_addr = blk_addr;
+    mrc->samples[slot].hash = hash;
+    indexSample(mrc, slot);
+    heapPush(mrc, slot);
+    stampSample(mrc, slot);
+
+    // Over budget: the largest hash sets the new threshold, every block at
+    // or above it leaves
+    if (mrc->num_samples > mrc->max_samples)
+    {
+        mrc->threshold = heapKey(mrc, 0);
+        while (mrc->num_samples > 0 && heapKey(mrc, 0) >= mrc->threshold)
+        {
+            unsigned victim = heapPop(mrc);
+            unindexSample(mrc, victim);
+            unstampSample(mrc, victim);
+            mrc->free_slots[mrc->num_free++] = victim;
+        }
+    }
+}
+
+double mrcMissRatio(MRC *mrc, uint64_t size_kb)
+{
+    if (mrc->references == 0)
+    {
+        return 0;
+    }
+
+    uint64_t first = size_kb / MRC_MIN_KB;
+    if (first > mrc->num_bins - 1)
+    {
+        first = mrc->num_bins - 1;
+    }
+
+    // SHARDS_adj: the weights miss the real reference count by the
+    // sampling error, which is booked as reuses at the shortest distance
+    double weighted = 0;
+    double misses = 0;
+    uint64_t bin;
+    for (bin = 0; bin < mrc->num_bins; bin++)
+    {
+        weighted += mrc->histogram[bin];
+        if (bin >= first)
+        {
+            misses += mrc->histogram[bin];
+        }
+    }
+    if (first == 0)
+    {
+        misses += mrc->references - weighted;
+    }
+
+    double ratio = misses / mrc->references;
+    return ratio < 0 ? 0 : ratio > 1 ? 1 : ratio;
+}
+
+static void printSize(uint64_t size_kb)
+{
+    if (size_kb >= 1024 * 1024)
+    {
+        printf("%6"PRIu64"GB", size_kb / (1024 * 1024));
+    }
+    else if (size_kb >= 1024)
+    {
+        printf("%6"PRIu64"MB", size_kb / 1024);
+    }
+    else
+    {
+        printf("%6"PRIu64"KB", size_kb);
+    }
+}
+
+void printMRC(MRC *mrc, const uint64_t *exact_misses)
+{
+    printf("Miss ratio curve (SHARDS, LRU): %"PRIu64" references, %"PRIu64" sampled "
+           "(%"PRIu64" blocks)\n", mrc->references, mrc->sampled, mrc->blocks_sampled);
+    printf("Sampling rate: %.6f (%u of %u samples, %zu KB)\n",
+           (double)mrc->threshold / MRC_HASH_MODULUS, mrc->num_samples, mrc->max_samples,
+           mrcMemory(mrc) / 1024);
+
+    printf("%8s %12s\n", "Size", "Miss ratio");
+    uint64_t size_kb;
+    for (size_kb = MRC_MIN_KB; size_kb <= MRC_MAX_KB; size_kb *= 2)
+    {
+        printSize(size_kb);
+        printf(" %11.4f%%\n", 100 * mrcMissRatio(mrc, size_kb));
+    }
+
+    if (exact_misses == NULL)
+    {
+        return;
+    }
+
+    printf("Against exact fully-associative lru():\n");
+    printf("%8s %12s %12s %12s\n", "Size", "Exact", "Estimate", "Error");
+    double total_error = 0;
+    double max_error = 0;
+    int i;
+    for (i = 0; i < MRC_EXACT_SIZES; i++)
+    {
+        double exact = mrc->references ? (double)exact_misses[i] / mrc->references : 0;
+        double estimate = mrcMissRatio(mrc, mrc_exact_kb[i]);
+        double error = fabs(estimate - exact);
+        total_error += error;
+        max_error = error > max_error ? error : max_error;
+
+        printSize(mrc_exact_kb[i]);
+        printf(" %11.4f%% %11.4f%% %+11.4f\n", 100 * exact, 100 * estimate,
+               100 * (estimate - exact));
+    }
+    printf("Mean absolute error: %.4f points (max %.4f)\n", 100 * total_error / MRC_EXACT_SIZES,
+           100 * max_error);
+}
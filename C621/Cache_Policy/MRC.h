@@ -0,0 +1,93 @@
+#ifndef __MRC_H__
+#define __MRC_H__
+
+#include "Cache.h"
+
+// Approximate LRU miss-ratio curve in constant memory, after SHARDS
+// (Waldspurger et al., FAST 2015), fixed-size variant.
+//
+// A block (blkAlign() of the request address) is sampled when its hash,
+// taken modulo MRC_HASH_MODULUS, is below a threshold T, so the sampling
+// rate is R = T / MRC_HASH_MODULUS and a block is either always or never
+// sampled. At most max_samples sampled blocks are tracked. When one more
+// arrives, the tracked block with the largest hash goes, T drops to that
+// hash and the rate with it. Memory stays fixed however many blocks the
+// trace touches.
+//
+// The reuse distance of a sampled reference (distinct sampled blocks since
+// its last one) scaled by 1 / R estimates its LRU stack distance, and the
+// reference stands for 1 / R references in the histogram. A cache of C
+// blocks misses the references at distance C or more, so one pass gives
+// the fully-associative LRU miss ratio of every size. The histogram has
+// one bin per MRC_MIN_KB of cache, up to MRC_MAX_KB; the gap between the
+// weighted and the real reference count goes to the first bin (SHARDS_adj).
+#define MRC_HASH_MODULUS (1U << 24)
+#define MRC_MIN_KB 32
+#define MRC_MAX_KB (1024 * 1024)
+#define MRC_EXACT_SIZES 4 // Sizes checked against an exact simulation
+#define MRC_MAX_SAMPLES (1U << 22)
+
+typedef struct MRC_Sample
+{
+    uint64_t blk_addr;
+    uint32_t hash;
+    uint32_t stamp; // Position in the recency tree
+}MRC_Sample;
+
+typedef struct MRC
+{
+    unsigned blk_shift;
+    unsigned max_samples;
+    uint32_t threshold; // T, blocks hashing below it are sampled
+
+    MRC_Sample *samples; // max_samples + 1 slots
+    unsigned num_samples;
+    unsigned *free_slots;
+    unsigned num_free;
+
+    unsigned *heap; // Slot indices, max-heap on hash
+    int *index; // Block hash to slot, -1 if empty
+    unsigned index_mask;
+
+    // Recency: each tracked block holds the stamp of its last reference,
+    // a Fenwick tree counts live stamps, so the blocks referenced since a
+    // stamp are the live ones above it. Stamps are renumbered when they
+    // run out.
+    unsigned num_stamps; // 2 * (max_samples + 1)
+    uint32_t *fenwick;
+    int *stamp_owner; // Slot holding each stamp, -1 if none
+    uint32_t clock; // Next stamp
+
+    // Weighted references per reuse distance bin, the last bin is cold
+    // misses and distances beyond MRC_MAX_KB
+    double *histogram;
+    unsigned num_bins;
+    unsigned bin_blocks; // Blocks per bin
+
+    uint64_t references;
+    uint64_t sampled;
+    uint64_t blocks_sampled; // Distinct blocks that got a slot
+}MRC;
+
+// max_samples tracked blocks of block_size bytes. NULL, with a message,
+// unless block_size is a power of two no larger than MRC_MIN_KB.
+MRC *initMRC(unsigned max_samples, unsigned block_size);
+void freeMRC(MRC *mrc);
+
+void mrcAccess(MRC *mrc, uint64_t addr);
+
+// Estimated miss ratio of a fully-associative LRU cache of size_kb,
+// rounded down to a multiple of MRC_MIN_KB
+double mrcMissRatio(MRC *mrc, uint64_t size_kb);
+size_t mrcMemory(const MRC *mrc);
+
+// Curve at every power of two from MRC_MIN_KB to MRC_MAX_KB. exact_misses
+// is NULL, or the misses of fully-associative lru() caches of
+// mrc_exact_kb[] sizes that saw the same requests, reported with the
+// estimate's error.
+void printMRC(MRC *mrc, const uint64_t *exact_misses);
+
+extern const unsigned mrc_samples;
+extern const unsigned mrc_exact_kb[MRC_EXACT_SIZES];
+
+#endif
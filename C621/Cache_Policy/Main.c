@@ -1,37 +1,537 @@
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
 #include "Trace.h"
 #include "Cache.h"
+#include "Snapshot.h"
+#include "Interval.h"
+#include "Parallel.h"
+#include "Profile.h"
+#include "DRAM.h"
+#include "Coherence.h"
+#include "TLB.h"
+#include "MRC.h"
 
 extern TraceParser *initTraceParser(const char * mem_file);
 extern bool getRequest(TraceParser *mem_trace);
 
 extern Cache* initCache();
+extern const unsigned block_size;
+extern const unsigned cache_size;
+extern const unsigned assoc;
+extern const Replacement_Policy default_policy;
+extern const Write_Policy write_policy;
+extern const unsigned write_buffer_depth;
 extern bool accessBlock(Cache *cache, Request *req, uint64_t access_time);
 extern bool insertBlock(Cache *cache, Request *req, uint64_t access_time, uint64_t *wb_addr);
 
-int main(int argc, const char *argv[])
-{	
-    if (argc != 2)
+static void usage(const char *prog)
+{
+    DRAM_Config dram_config;
+    initDRAMConfig(&dram_config, block_size);
+    TLB_Config tlb_config;
+    initTLBConfig(&tlb_config);
+
+    printf("Usage: %s [-b <block-bytes>] [-c <cache-KB>] [-a <assoc>] [-r <policy>]\n"
+           "       [-w <warmup-requests>] [-s <save-snapshot>] [-l <load-snapshot>]\n"
+           "       [-W <write-policy>] [-N] [-D <write-buffer-depth>]\n"
+           "       [-M <channels>[:<ranks>[:<banks>]] [-g <dram-cycles>]] [-C <cores>]\n"
+           "       [-T <page-policy> [-H <thp-threshold>]] [-m <samples> [-V]]\n"
+           "       [-i <interval-requests> -o <interval-file>] [-k <chunks>[:<warmup>] [-V]] %s\n",
+           prog, "<mem-file>");
+    printf("  -b, -c, -a  cache geometry (default %uB blocks, %uKB, %u-way)\n",
+           block_size, cache_size, assoc);
+    printf("  -r  replacement policy: lru, lfu, srrip, brrip, drrip or ship (default %s)\n",
+           replacementPolicyName(default_policy));
+    printf("  -W  write hits: wb (write-back) or wt (write-through), default %s\n",
+           writePolicyName(write_policy));
+    printf("  -N  no-write-allocate, store misses bypass the cache\n");
+    printf("  -D  coalescing write buffer entries, 0 for none, at most %u (default %u)\n",
+           WRITE_BUFFER_MAX_DEPTH, write_buffer_depth);
+    printf("  -M  model a DRAM behind the misses and writebacks (default geometry %u:%u:%u)\n",
+           dram_config.channels, dram_config.ranks, dram_config.banks);
+    printf("  -g  with -M, DRAM cycles between trace requests (default %g)\n",
+           dram_config.time_scale);
+    printf("  -C  one private cache per core (at most %u), kept coherent with MESI;\n",
+           COHERENCE_MAX_CORES);
+    printf("      requests go to the cache of their core ID modulo <cores>\n");
+    printf("  -T  translate through a dTLB, STLB and page walks first, with pages of\n");
+    printf("      4k, 2m, 1g or thp (4KB until -H 4KB pages of a 2MB region are touched,\n");
+    printf("      default %u); walk references are loads to the cache\n", tlb_config.thp_threshold);
+    printf("  -m  only estimate the LRU miss ratio curve from %uKB to %uGB, sampling at\n",
+           MRC_MIN_KB, MRC_MAX_KB / (1024 * 1024));
+    printf("      most <samples> blocks (suggested %u, -b up to %uKB); with -V also\n",
+           mrc_samples, MRC_MIN_KB);
+    printf("      simulates fully-associative lru() at %uKB, %uKB, %uMB and %uMB and\n",
+           mrc_exact_kb[0], mrc_exact_kb[1], mrc_exact_kb[2] / 1024, mrc_exact_kb[3] / 1024);
+    printf("      reports the error\n");
+    printf("  -w  the first N requests only warm up the cache and are not counted;\n");
+    printf("      when a snapshot is loaded they are skipped instead\n");
+    printf("  -s  save the cache state after the warmup (or at the end of the run)\n");
+    printf("  -l  restore the cache state from a snapshot before running\n");
+    printf("  -i  emit a statistics record every N requests to the -o file\n");
+    printf("  -o  interval sink: *.csv or - (stdout) for CSV, anything else is binary\n");
+    printf("  -k  simulate the trace as up to %u parallel chunks, each warmed on the\n",
+           MAX_CHUNKS);
+    printf("      <warmup> requests before it (default %d); builds <mem-file>.idx once\n",
+           CHUNK_WARMUP);
+    printf("  -V  with -k, also run the trace serially and report the deviation\n");
+    printf("  <mem-file> may be a live framed stream: - (stdin), unix:<socket-path> or a FIFO\n");
+}
+
+// A decimal count from 0 to max, anything else (signs included) is rejected
+static bool parseCount(const char *arg, unsigned max, unsigned *count)
+{
+    char *end;
+    errno = 0;
+    unsigned long value = strtoul(arg, &end, 10);
+    if (!isdigit((unsigned char)arg[0]) || *end != '\0' || errno != 0 || value > max)
+    {
+        return false;
+    }
+    *count = value;
+    return true;
+}
+
+static const char *interval_fields[] = {"requests", "hits", "misses", "hit_rate",
+                                        "evictions", "writebacks", "read_bytes", "write_bytes"};
+
+// Statistics of the interval that just ended
+static void emitInterval(Interval_Writer *writer, uint64_t requests, uint64_t hits,
+                         uint64_t misses, uint64_t evictions, uint64_t writebacks,
+                         uint64_t read_bytes, uint64_t write_bytes)
+{
+    double fields[8];
+    fields[0] = requests;
+    fields[1] = hits;
+    fields[2] = misses;
+    fields[3] = hits + misses ? (double)hits / (hits + misses) : 0;
+    fields[4] = evictions;
+    fields[5] = writebacks;
+    fields[6] = read_bytes;
+    fields[7] = write_bytes;
+    pushInterval(writer, fields);
+}
+
+// Bytes written to the next level, counting what the write buffer still holds
+static uint64_t writeTraffic(const Cache *cache)
+{
+    return cache->write_bytes + pendingWriteBytes(cache);
+}
+
+int main(int argc, char *argv[])
+{
+    Cache_Config config;
+    initCacheConfig(&config);
+    uint64_t warmup = 0;
+    const char *save_file = NULL;
+    const char *load_file = NULL;
+    uint64_t interval_len = 0;
+    const char *interval_file = NULL;
+    unsigned num_chunks = 0;
+    uint64_t chunk_warmup = CHUNK_WARMUP;
+    bool chunk_verify = false;
+    bool mrc_verify = false;
+    bool use_dram = false;
+    unsigned num_cores = 0;
+    bool use_tlb = false;
+    unsigned mrc_budget = 0;
+    TLB_Config tlb_config;
+    initTLBConfig(&tlb_config);
+    DRAM_Config dram_config;
+    initDRAMConfig(&dram_config, config.block_size);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:c:a:r:W:ND:M:g:C:T:H:m:w:s:l:i:o:k:V")) != -1)
     {
-        printf("Usage: %s %s\n", argv[0], "<mem-file>");
+        switch (opt)
+        {
+            case 'b':
+                if (!parseCount(optarg, UINT_MAX, &config.block_size))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'c':
+                if (!parseCount(optarg, UINT_MAX, &config.cache_size))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'a':
+                if (!parseCount(optarg, UINT_MAX, &config.assoc))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'r':
+                config.policy = parseReplacementPolicy(optarg);
+                if (config.policy == (Replacement_Policy)-1)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'W':
+                config.write_policy = parseWritePolicy(optarg);
+                if (config.write_policy == (Write_Policy)-1)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'N': config.allocate_policy = NO_WRITE_ALLOCATE; break;
+            case 'D':
+                if (!parseCount(optarg, WRITE_BUFFER_MAX_DEPTH, &config.write_buffer_depth))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'M':
+                use_dram = true;
+                if (!parseDRAMConfig(optarg, &dram_config))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'g': dram_config.time_scale = atof(optarg); break;
+            case 'C':
+                if (!parseCount(optarg, COHERENCE_MAX_CORES, &num_cores) || num_cores == 0)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'T':
+                use_tlb = true;
+                tlb_config.policy = parsePagePolicy(optarg);
+                if (tlb_config.policy == (Page_Policy)-1)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'H': tlb_config.thp_threshold = atoi(optarg); break;
+            case 'm':
+                if (!parseCount(optarg, MRC_MAX_SAMPLES, &mrc_budget) || mrc_budget == 0)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'w': warmup = strtoull(optarg, NULL, 10); break;
+            case 's': save_file = optarg; break;
+            case 'l': load_file = optarg; break;
+            case 'i': interval_len = strtoull(optarg, NULL, 10); break;
+            case 'o': interval_file = optarg; break;
+            case 'k':
+                if (strchr(optarg, ':') != NULL)
+                {
+                    chunk_warmup = strtoull(strchr(optarg, ':') + 1, NULL, 10);
+                    *strchr(optarg, ':') = '\0';
+                }
+                if (!parseCount(optarg, MAX_CHUNKS, &num_chunks) || num_chunks == 0)
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            // Check -k or -m against an exact serial run
+            case 'V':
+                chunk_verify = true;
+                mrc_verify = true;
+                break;
+            default: usage(argv[0]); return 0;
+        }
+    }
+
+    if (optind != argc - 1 || !checkCacheConfig(&config) ||
+        (interval_len > 0) != (interval_file != NULL) ||
+        (num_chunks > 0 && (warmup > 0 || save_file || load_file || interval_file || use_dram)) ||
+        (num_cores > 0 && (num_chunks > 0 || warmup > 0 || save_file || load_file || interval_file)) ||
+        (use_tlb && (num_chunks > 0 || num_cores > 0)) ||
+        (mrc_budget > 0 && (num_chunks > 0 || num_cores > 0 || use_tlb || use_dram ||
+                            warmup > 0 || save_file || load_file || interval_file)))
+    {
+        usage(argv[0]);
+
+        return 0;
+    }
+
+    PROFILE_INIT("Cache_Policy");
+    PROFILE_BEGIN(PHASE_SETUP);
+
+    // Chunk-parallel run over an indexed trace
+    if (num_chunks > 0)
+    {
+        PROFILE_END(PHASE_SETUP);
+
+        PROFILE_BEGIN(PHASE_RUN);
+        Chunk_Result *chunks = (Chunk_Result *)malloc(num_chunks * sizeof(Chunk_Result));
+        Chunk_Result merged, reference;
+        if (!simulateChunks(argv[optind], &config, num_chunks, chunk_warmup, chunks, &merged,
+                            chunk_verify ? &reference : NULL))
+        {
+            return 1;
+        }
+        PROFILE_END(PHASE_RUN);
+
+        PROFILE_BEGIN(PHASE_REPORT);
+        printChunkReport(chunks, num_chunks, &merged, chunk_verify ? &reference : NULL);
+        PROFILE_END(PHASE_REPORT);
+        PROFILE_REPORT();
+
+        return 0;
+    }
+
+    // Coherent private caches, optionally sharing one DRAM
+    if (num_cores > 0)
+    {
+        Coherence *coh = initCoherence(&config, num_cores);
+        TraceParser *mem_trace = initTraceParser(argv[optind]);
+
+        DRAM *dram = NULL;
+        unsigned i;
+        if (use_dram)
+        {
+            dram_config.block_bytes = config.block_size;
+            dram = initDRAM(&dram_config);
+            if (dram == NULL)
+            {
+                return 1;
+            }
+            for (i = 0; i < num_cores; i++)
+            {
+                coh->caches[i]->dram = dram;
+            }
+        }
+        PROFILE_END(PHASE_SETUP);
+
+        PROFILE_BEGIN(PHASE_RUN);
+        uint64_t cycles = 0;
+        while (getRequest(mem_trace))
+        {
+            PROFILE_STAGE(STAGE_PARSE);
+            coherentAccess(coh, mem_trace->cur_req, cycles++);
+            PROFILE_STAGE(STAGE_SIMULATE);
+            PROFILE_NEXT_RECORD();
+        }
+        PROFILE_END(PHASE_RUN);
+
+        PROFILE_BEGIN(PHASE_REPORT);
+        uint64_t writebacks = 0;
+        uint64_t read_bytes = 0;
+        uint64_t write_bytes = 0;
+        for (i = 0; i < num_cores; i++)
+        {
+            if (dram != NULL)
+            {
+                flushWriteBuffer(coh->caches[i]);
+            }
+            writebacks += coh->caches[i]->num_writebacks;
+            read_bytes += coh->caches[i]->read_bytes;
+            write_bytes += writeTraffic(coh->caches[i]);
+        }
+
+        printCoherenceReport(coh);
+        printf("Writebacks (dirty): %"PRIu64"\n", writebacks);
+        printf("Read traffic: %"PRIu64" bytes\n", read_bytes);
+        printf("Write traffic: %"PRIu64" bytes\n", write_bytes);
+        if (dram != NULL)
+        {
+            drainDRAM(dram);
+            printDRAMStats(dram);
+            freeDRAM(dram);
+        }
+        freeCoherence(coh);
+        PROFILE_END(PHASE_REPORT);
+        PROFILE_REPORT();
+
+        return 0;
+    }
+
+    // Sampled miss ratio curve, with exact lru() caches to check it against
+    if (mrc_budget > 0)
+    {
+        MRC *mrc = initMRC(mrc_budget, config.block_size);
+        if (mrc == NULL)
+        {
+            return 1;
+        }
+        TraceParser *mem_trace = initTraceParser(argv[optind]);
+
+        // Fully associative like the curve, a single set of tag-indexed ways
+        Cache *exact[MRC_EXACT_SIZES];
+        uint64_t exact_misses[MRC_EXACT_SIZES] = {0};
+        int i;
+        for (i = 0; mrc_verify && i < MRC_EXACT_SIZES; i++)
+        {
+            Cache_Config exact_config = config;
+            exact_config.cache_size = mrc_exact_kb[i];
+            exact_config.assoc = (uint64_t)mrc_exact_kb[i] * 1024 / config.block_size;
+            exact_config.policy = POLICY_LRU;
+            exact[i] = initCacheFromConfig(&exact_config);
+        }
+        PROFILE_END(PHASE_SETUP);
+
+        PROFILE_BEGIN(PHASE_RUN);
+        uint64_t cycles = 0;
+        while (getRequest(mem_trace))
+        {
+            PROFILE_STAGE(STAGE_PARSE);
+            mrcAccess(mrc, mem_trace->cur_req->load_or_store_addr);
+            for (i = 0; mrc_verify && i < MRC_EXACT_SIZES; i++)
+            {
+                if (!accessBlock(exact[i], mem_trace->cur_req, cycles))
+                {
+                    ++exact_misses[i];
+
+                    uint64_t wb_addr;
+                    insertBlock(exact[i], mem_trace->cur_req, cycles, &wb_addr);
+                }
+            }
+            ++cycles;
+            PROFILE_STAGE(STAGE_SIMULATE);
+            PROFILE_NEXT_RECORD();
+        }
+        PROFILE_END(PHASE_RUN);
+
+        PROFILE_BEGIN(PHASE_REPORT);
+        printMRC(mrc, mrc_verify ? exact_misses : NULL);
+        for (i = 0; mrc_verify && i < MRC_EXACT_SIZES; i++)
+        {
+            freeCache(exact[i]);
+        }
+        freeMRC(mrc);
+        PROFILE_END(PHASE_REPORT);
+        PROFILE_REPORT();
 
         return 0;
     }
 
+    Interval_Writer *intervals = NULL;
+    if (interval_file != NULL)
+    {
+        intervals = initIntervalWriter(interval_file, interval_fields, 8);
+        if (intervals == NULL)
+        {
+            return 1;
+        }
+    }
+
     // Initialize a CPU trace parser
-    TraceParser *mem_trace = initTraceParser(argv[1]);
+    TraceParser *mem_trace = initTraceParser(argv[optind]);
+
+    // Initialize a Cache, either cold or from a warmed snapshot
+    Cache *cache;
+    if (load_file != NULL)
+    {
+        cache = loadCache(load_file);
+        if (cache == NULL)
+        {
+            return 1;
+        }
+        configureWrites(cache, config.write_policy, config.allocate_policy,
+                        config.write_buffer_depth);
+    }
+    else
+    {
+        cache = initCacheFromConfig(&config);
+    }
+
+    uint64_t cycles = 0;
+
+    TLB *tlb = use_tlb ? initTLB(&tlb_config) : NULL;
+
+    PROFILE_END(PHASE_SETUP);
+
+    // Warming up the cache (or skipping the region a snapshot already covers).
+    // Cycles keep advancing so a snapshot and a full run see the same timestamps.
+    PROFILE_BEGIN(PHASE_WARMUP);
+    bool more = true;
+    while (cycles < warmup && (more = getRequest(mem_trace)))
+    {
+        if (load_file == NULL)
+        {
+            if (tlb != NULL)
+            {
+                translateRequest(tlb, cache, mem_trace->cur_req, cycles);
+            }
+            if (!accessBlock(cache, mem_trace->cur_req, cycles))
+            {
+                uint64_t wb_addr;
+                insertBlock(cache, mem_trace->cur_req, cycles, &wb_addr);
+            }
+        }
+        ++cycles;
+    }
+    if (tlb != NULL)
+    {
+        memset(&(tlb->stats), 0, sizeof(TLB_Stats));
+    }
+    PROFILE_END(PHASE_WARMUP);
+
+    if (save_file != NULL && warmup > 0)
+    {
+        if (!saveCache(cache, save_file))
+        {
+            return 1;
+        }
+    }
+
+    // The DRAM only sees the measured requests
+    DRAM *dram = NULL;
+    if (use_dram)
+    {
+        dram_config.block_bytes = cache->blk_mask + 1;
+        dram = initDRAM(&dram_config);
+        if (dram == NULL)
+        {
+            return 1;
+        }
+        cache->dram = dram;
+    }
 
-    // Initialize a Cache
-    Cache *cache = initCache();
-    
     // Running the trace
     uint64_t num_of_reqs = 0;
     uint64_t hits = 0;
     uint64_t misses = 0;
     uint64_t num_evicts = 0;
 
-    uint64_t cycles = 0;
-    while (getRequest(mem_trace))
+    // Counters at the end of the warmup
+    uint64_t base_writebacks = cache->num_writebacks;
+    uint64_t base_read_bytes = cache->read_bytes;
+    uint64_t base_write_bytes = writeTraffic(cache);
+    uint64_t base_writes = cache->num_writes + cache->write_buffer_count;
+    uint64_t base_coalesced = cache->num_coalesced;
+
+    // Counters at the start of the current interval
+    uint64_t interval_hits = 0;
+    uint64_t interval_misses = 0;
+    uint64_t interval_evicts = 0;
+    uint64_t interval_writebacks = base_writebacks;
+    uint64_t interval_read_bytes = base_read_bytes;
+    uint64_t interval_write_bytes = base_write_bytes;
+    uint64_t interval_left = interval_len;
+
+    PROFILE_BEGIN(PHASE_RUN);
+    while (more && getRequest(mem_trace))
     {
+        PROFILE_STAGE(STAGE_PARSE);
+
+        // Translation first, its page walk reads go through the cache
+        if (tlb != NULL)
+        {
+            translateRequest(tlb, cache, mem_trace->cur_req, cycles);
+        }
+
         // Step one, accessBlock()
         if (accessBlock(cache, mem_trace->cur_req, cycles))
         {
@@ -54,8 +554,78 @@ int main(int argc, const char *argv[])
 
         ++num_of_reqs;
         ++cycles;
+
+        if (intervals != NULL && --interval_left == 0)
+        {
+            uint64_t write_bytes = writeTraffic(cache);
+            emitInterval(intervals, num_of_reqs, hits - interval_hits,
+                         misses - interval_misses, num_evicts - interval_evicts,
+                         cache->num_writebacks - interval_writebacks,
+                         cache->read_bytes - interval_read_bytes, write_bytes - interval_write_bytes);
+            interval_hits = hits;
+            interval_misses = misses;
+            interval_evicts = num_evicts;
+            interval_writebacks = cache->num_writebacks;
+            interval_read_bytes = cache->read_bytes;
+            interval_write_bytes = write_bytes;
+            interval_left = interval_len;
+        }
+
+        PROFILE_STAGE(STAGE_SIMULATE);
+        PROFILE_NEXT_RECORD();
+    }
+    PROFILE_END(PHASE_RUN);
+
+    PROFILE_BEGIN(PHASE_REPORT);
+
+    if (dram != NULL)
+    {
+        // What the write buffer holds reaches the DRAM at the end of the run
+        flushWriteBuffer(cache);
+        drainDRAM(dram);
+    }
+
+    if (intervals != NULL)
+    {
+        // Partial last interval
+        if (interval_left != interval_len)
+        {
+            emitInterval(intervals, num_of_reqs, hits - interval_hits,
+                         misses - interval_misses, num_evicts - interval_evicts,
+                         cache->num_writebacks - interval_writebacks,
+                         cache->read_bytes - interval_read_bytes,
+                         writeTraffic(cache) - interval_write_bytes);
+        }
+        closeIntervalWriter(intervals);
+    }
+
+    if (save_file != NULL && warmup == 0)
+    {
+        if (!saveCache(cache, save_file))
+        {
+            return 1;
+        }
     }
 
     double hit_rate = (double)hits / ((double)hits + (double)misses);
     printf("Hit rate: %lf%%\n", hit_rate * 100);
+    printf("Evictions: %"PRIu64", Writebacks (dirty): %"PRIu64"\n",
+           num_evicts, cache->num_writebacks - base_writebacks);
+    printf("Read traffic: %"PRIu64" bytes\n", cache->read_bytes - base_read_bytes);
+    printf("Write traffic: %"PRIu64" bytes (%"PRIu64" writes, %"PRIu64" coalesced)\n",
+           writeTraffic(cache) - base_write_bytes,
+           cache->num_writes + cache->write_buffer_count - base_writes,
+           cache->num_coalesced - base_coalesced);
+    if (tlb != NULL)
+    {
+        printTLBStats(tlb);
+        freeTLB(tlb);
+    }
+    if (dram != NULL)
+    {
+        printDRAMStats(dram);
+        freeDRAM(dram);
+    }
+    PROFILE_END(PHASE_REPORT);
+    PROFILE_REPORT();
 }
@@ -0,0 +1,181 @@
+#include "Parallel.h"
+
+#include <pthread.h>
+
+#include "Trace.h"
+#include "Index.h"
+
+typedef struct Chunk_Worker
+{
+    const char *mem_file;
+    const Cache_Config *config;
+    const Trace_Index *index;
+
+    uint64_t warm_first; // First request the cache sees
+    Chunk_Result *result;
+    bool ok;
+
+    pthread_t thread;
+}Chunk_Worker;
+
+static void *simulateChunk(void *arg)
+{
+    Chunk_Worker *worker = (Chunk_Worker *)arg;
+    const Cache_Config *config = worker->config;
+    Chunk_Result *result = worker->result;
+
+    TraceParser *mem_trace = initTraceParser(worker->mem_file);
+    if (!seekTraceParser(mem_trace, worker->index, worker->warm_first))
+    {
+        closeTraceParser(mem_trace);
+        return NULL;
+    }
+
+    Cache *cache = initCacheFromConfig(config);
+
+    uint64_t writebacks = 0;
+    uint64_t read_bytes = 0;
+    uint64_t write_bytes = 0;
+    uint64_t cycles;
+    for (cycles = worker->warm_first; cycles < result->last; cycles++)
+    {
+        if (!getRequest(mem_trace))
+        {
+            // Trace shorter than its index, the parser is already released
+            freeCache(cache);
+            return NULL;
+        }
+
+        if (cycles == result->first)
+        {
+            writebacks = cache->num_writebacks;
+            read_bytes = cache->read_bytes;
+            write_bytes = cache->write_bytes + pendingWriteBytes(cache);
+        }
+
+        bool counted = cycles >= result->first;
+        if (accessBlock(cache, mem_trace->cur_req, cycles))
+        {
+            result->hits += counted;
+        }
+        else
+        {
+            result->misses += counted;
+
+            uint64_t wb_addr;
+            if (insertBlock(cache, mem_trace->cur_req, cycles, &wb_addr))
+            {
+                result->evictions += counted;
+            }
+        }
+    }
+    result->writebacks = cache->num_writebacks - writebacks;
+    result->read_bytes = cache->read_bytes - read_bytes;
+    result->write_bytes = cache->write_bytes + pendingWriteBytes(cache) - write_bytes;
+    closeTraceParser(mem_trace);
+    freeCache(cache);
+
+    worker->ok = true;
+    return NULL;
+}
+
+bool simulateChunks(const char *mem_file, const Cache_Config *config, unsigned num_chunks,
+                    uint64_t warmup, Chunk_Result *chunks, Chunk_Result *merged,
+                    Chunk_Result *reference)
+{
+    Trace_Index *index = loadTraceIndex(mem_file);
+    if (index == NULL)
+    {
+        return false;
+    }
+
+    unsigned num_workers = num_chunks + (reference != NULL);
+    Chunk_Worker *workers = (Chunk_Worker *)calloc(num_workers, sizeof(Chunk_Worker));
+
+    int i;
+    for (i = 0; i < num_workers; i++)
+    {
+        Chunk_Result *result = i < num_chunks ? &chunks[i] : reference;
+        memset(result, 0, sizeof(Chunk_Result));
+
+        if (i < num_chunks)
+        {
+            result->first = index->num_records * i / num_chunks;
+            result->last = index->num_records * (i + 1) / num_chunks;
+        }
+        else
+        {
+            result->first = 0;
+            result->last = index->num_records;
+        }
+
+        workers[i].mem_file = mem_file;
+        workers[i].config = config;
+        workers[i].index = index;
+        workers[i].warm_first = result->first > warmup ? result->first - warmup : 0;
+        workers[i].result = result;
+        pthread_create(&workers[i].thread, NULL, simulateChunk, &workers[i]);
+    }
+
+    bool ok = true;
+    memset(merged, 0, sizeof(Chunk_Result));
+    merged->last = index->num_records;
+    for (i = 0; i < num_workers; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        ok = ok && workers[i].ok;
+
+        if (i < num_chunks)
+        {
+            merged->hits += chunks[i].hits;
+            merged->misses += chunks[i].misses;
+            merged->evictions += chunks[i].evictions;
+            merged->writebacks += chunks[i].writebacks;
+            merged->read_bytes += chunks[i].read_bytes;
+            merged->write_bytes += chunks[i].write_bytes;
+        }
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "%s: trace changed under its index\n", mem_file);
+    }
+
+    free(workers);
+    freeTraceIndex(index);
+
+    return ok;
+}
+
+static double hitRate(Chunk_Result *result)
+{
+    return result->hits + result->misses ?
+           100.0 * result->hits / (result->hits + result->misses) : 0;
+}
+
+void printChunkReport(Chunk_Result *chunks, unsigned num_chunks,
+                      Chunk_Result *merged, Chunk_Result *reference)
+{
+    printf("%-6s %14s %14s %12s %12s\n", "Chunk", "First", "Last", "Misses", "Hit rate");
+
+    int i;
+    for (i = 0; i < num_chunks; i++)
+    {
+        printf("%-6d %14"PRIu64" %14"PRIu64" %12"PRIu64" %11.4f%%\n", i, chunks[i].first,
+               chunks[i].last, chunks[i].misses, hitRate(&chunks[i]));
+    }
+
+    printf("Hit rate: %lf%%\n", hitRate(merged));
+    printf("Evictions: %"PRIu64", Writebacks (dirty): %"PRIu64"\n", merged->evictions, merged->writebacks);
+    printf("Read traffic: %"PRIu64" bytes\n", merged->read_bytes);
+    printf("Write traffic: %"PRIu64" bytes\n", merged->write_bytes);
+
+    if (reference != NULL)
+    {
+        int64_t delta = (int64_t)merged->misses - (int64_t)reference->misses;
+
+        printf("Serial hit rate: %lf%%\n", hitRate(reference));
+        printf("Deviation: %+"PRId64" misses (%+.2f%%), %+f hit rate points\n",
+               delta, reference->misses ? 100.0 * delta / reference->misses : 0,
+               hitRate(merged) - hitRate(reference));
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Cache.h"
+
+#define CHUNK_WARMUP 100000 // Default requests a chunk warms up on
+#define MAX_CHUNKS 1024 // One thread each
+
+// Statistics over requests [first, last) of the trace
+typedef struct Chunk_Result
+{
+    uint64_t first;
+    uint64_t last;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;
+    uint64_t read_bytes;
+    uint64_t write_bytes; // Including what the write buffer holds at the end
+}Chunk_Result;
+
+// Split the trace (through its sidecar index, see Index.h) into num_chunks
+// contiguous chunks and simulate them concurrently, one thread and one
+// private cache per chunk. Each cache is first warmed, uncounted, on the
+// warmup requests before its chunk; timestamps stay the global request
+// numbers, as in a serial run. chunks[] receives the per-chunk statistics
+// and merged their sum. If reference is not NULL, one more thread runs the
+// whole trace serially into it. Returns false if the trace cannot be indexed.
+bool simulateChunks(const char *mem_file, const Cache_Config *config, unsigned num_chunks,
+                    uint64_t warmup, Chunk_Result *chunks, Chunk_Result *merged,
+                    Chunk_Result *reference);
+
+// Per-chunk table and the merged result, with its deviation from the
+// serial reference when there is one
+void printChunkReport(Chunk_Result *chunks, unsigned num_chunks,
+                      Chunk_Result *merged, Chunk_Result *reference);
+
+#endif
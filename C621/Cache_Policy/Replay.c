@@ -0,0 +1,51 @@
+#include <unistd.h>
+
+#include "Trace.h"
+
+// Stand-in for a live tracer: replays a text memory trace as a framed stream
+int main(int argc, const char *argv[])
+{
+    if (argc != 2 && argc != 3)
+    {
+        printf("Usage: %s %s\n", argv[0], "<mem-file> [- | unix:<path> | <fifo>]");
+
+        return 0;
+    }
+
+    int sink = openStreamSink(argc == 3 ? argv[2] : "-");
+    if (sink < 0 || !writeStreamHeader(sink, MEM_STREAM_MAGIC))
+    {
+        return 1;
+    }
+
+    TraceParser *mem_trace = initTraceParser(argv[1]);
+
+    Request_Record *records = (Request_Record *)calloc(STREAM_FRAME_RECORDS, sizeof(Request_Record));
+    uint32_t count = 0;
+    bool ok = true;
+
+    while (ok && getRequest(mem_trace))
+    {
+        Request *req = mem_trace->cur_req;
+
+        records[count].PC = req->PC;
+        records[count].load_or_store_addr = req->load_or_store_addr;
+        records[count].core_id = req->core_id;
+        records[count].req_type = req->req_type;
+
+        if (++count == STREAM_FRAME_RECORDS)
+        {
+            ok = writeStreamFrame(sink, records, count, sizeof(Request_Record));
+            count = 0;
+        }
+    }
+
+    // Last partial frame and the end-of-stream frame
+    ok = ok && (count == 0 || writeStreamFrame(sink, records, count, sizeof(Request_Record)));
+    ok = ok && writeStreamFrame(sink, records, 0, sizeof(Request_Record));
+
+    free(records);
+    close(sink);
+
+    return ok ? 0 : 1;
+}
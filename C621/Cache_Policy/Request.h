@@ -18,6 +18,8 @@ typedef struct Request
 
     int core_id; // The core of PC is running on
 
+    int size; // Bytes accessed, 0 if unknown (stores then write STORE_BYTES)
+
 }Request;
 
 #endif
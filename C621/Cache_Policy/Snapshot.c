@@ -0,0 +1,168 @@
+#include "Snapshot.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool saveCache(Cache *cache, const char *snapshot_file)
+{
+    FILE *fd = fopen(snapshot_file, "wb");
+    if (fd == NULL)
+    {
+        perror(snapshot_file);
+        return false;
+    }
+
+    // Wide sets age through per-set offsets, the file holds real RRPVs
+    if (cache->tag_index != NULL)
+    {
+        settleIndexedRRPVs(cache);
+    }
+
+    Cache_Snapshot_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.blk_mask = cache->blk_mask;
+    header.num_blocks = cache->num_blocks;
+    header.num_sets = cache->num_sets;
+    header.num_ways = cache->num_ways;
+    header.policy = cache->policy;
+    header.rrpv_words = cache->rrpv_words;
+    header.psel = cache->psel;
+    header.brrip_count = cache->brrip_count;
+    header.num_shct = SHCT_ENTRIES;
+
+    size_t num_rrpv = (size_t)cache->num_sets * cache->rrpv_words;
+
+    bool ok = fwrite(&header, sizeof(header), 1, fd) == 1;
+    ok = ok && fwrite(cache->blocks, sizeof(Cache_Block), cache->num_blocks, fd) == cache->num_blocks;
+    ok = ok && fwrite(cache->rrpv, sizeof(uint64_t), num_rrpv, fd) == num_rrpv;
+    ok = ok && fwrite(cache->shct, sizeof(uint8_t), SHCT_ENTRIES, fd) == SHCT_ENTRIES;
+
+    if (fclose(fd) != 0 || !ok)
+    {
+        fprintf(stderr, "%s: failed to write snapshot\n", snapshot_file);
+        return false;
+    }
+
+    return true;
+}
+
+Cache *loadCache(const char *snapshot_file)
+{
+    int fd = open(snapshot_file, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(snapshot_file);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < sizeof(Cache_Snapshot_Header))
+    {
+        fprintf(stderr, "%s: not a cache snapshot\n", snapshot_file);
+        close(fd);
+        return NULL;
+    }
+
+    // Private mapping: pages are only copied once the simulation modifies them
+    char *base = (char *)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        perror(snapshot_file);
+        return NULL;
+    }
+
+    Cache_Snapshot_Header *header = (Cache_Snapshot_Header *)base;
+
+    size_t blocks_len = (size_t)header->num_blocks * sizeof(Cache_Block);
+    size_t rrpv_len = (size_t)header->num_sets * header->rrpv_words * sizeof(uint64_t);
+    size_t shct_len = (size_t)header->num_shct * sizeof(uint8_t);
+
+    if (memcmp(header->magic, CACHE_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        st.st_size != sizeof(*header) + blocks_len + rrpv_len + shct_len ||
+        header->num_shct != SHCT_ENTRIES)
+    {
+        fprintf(stderr, "%s: not a cache snapshot\n", snapshot_file);
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    // The geometry must be one initCacheGeometry() builds
+    uint64_t block_size = header->blk_mask + 1;
+    if ((block_size & header->blk_mask) != 0 || header->num_ways == 0 ||
+        header->num_blocks % header->num_ways != 0 ||
+        header->num_sets != header->num_blocks / header->num_ways ||
+        (header->num_sets & (header->num_sets - 1)) != 0 ||
+        header->num_blocks * block_size % 1024 != 0 || header->policy > POLICY_SHIP)
+    {
+        fprintf(stderr, "%s: not a cache snapshot\n", snapshot_file);
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    Cache *cache = initCacheGeometry(block_size, header->num_blocks * block_size / 1024,
+                                     header->num_ways);
+
+    if (header->blk_mask != cache->blk_mask || header->num_blocks != cache->num_blocks ||
+        header->num_sets != cache->num_sets || header->num_ways != cache->num_ways ||
+        header->rrpv_words != cache->rrpv_words)
+    {
+        fprintf(stderr, "%s: snapshot geometry does not match this cache\n", snapshot_file);
+        freeCache(cache);
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    // Every block must sit at its own set and way, as saveCache() wrote it,
+    // with a signature that indexes the SHCT
+    Cache_Block *blocks = (Cache_Block *)(base + sizeof(*header));
+    int i;
+    for (i = 0; i < cache->num_blocks; i++)
+    {
+        if (blocks[i].set != i / cache->num_ways || blocks[i].way != i % cache->num_ways ||
+            blocks[i].signature_memory >= SHCT_ENTRIES)
+        {
+            fprintf(stderr, "%s: corrupt block %d\n", snapshot_file, i);
+            freeCache(cache);
+            munmap(base, st.st_size);
+            return NULL;
+        }
+    }
+
+    // Blocks are used in place, re-point the set ways at them
+    free(cache->blocks);
+    cache->blocks = blocks;
+
+    for (i = 0; i < cache->num_blocks; i++)
+    {
+        Cache_Block *blk = &(cache->blocks[i]);
+
+        cache->sets[blk->set].ways[blk->way] = blk;
+    }
+
+    free(cache->rrpv);
+    cache->rrpv = (uint64_t *)(base + sizeof(*header) + blocks_len);
+
+    // The SHCT is tiny and not 8-byte sized in general, so it is copied out
+    memcpy(cache->shct, base + sizeof(*header) + blocks_len + rrpv_len, shct_len);
+
+    cache->policy = (Replacement_Policy)header->policy;
+    cache->psel = header->psel;
+    cache->brrip_count = header->brrip_count;
+
+    // The tag index was built over the cold blocks
+    if (cache->tag_index != NULL)
+    {
+        freeTagIndex(cache->tag_index);
+        cache->tag_index = initTagIndex(cache);
+    }
+
+    cache->snapshot_base = base;
+    cache->snapshot_len = st.st_size;
+
+    return cache;
+}
@@ -0,0 +1,44 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdbool.h>
+
+#include "Cache.h"
+
+#define CACHE_SNAPSHOT_MAGIC "CSNAP002"
+
+// On-disk layout:
+//   Cache_Snapshot_Header
+//   Cache_Block  blocks[num_blocks]
+//   uint64_t     rrpv[num_sets * rrpv_words]
+//   uint8_t      shct[num_shct]
+// Every section starts on an 8-byte boundary so the file can be mapped
+// and used in place.
+typedef struct Cache_Snapshot_Header
+{
+    char magic[8];
+
+    uint64_t blk_mask;
+
+    uint32_t num_blocks;
+    uint32_t num_sets;
+    uint32_t num_ways;
+    uint32_t policy;
+
+    uint32_t rrpv_words;
+    uint32_t psel;
+    uint32_t brrip_count;
+    uint32_t num_shct;
+}Cache_Snapshot_Header;
+
+// Write all blocks (tags and metadata), the RRIP state and the SHCT to a
+// snapshot file
+bool saveCache(Cache *cache, const char *snapshot_file);
+
+// Map a snapshot file and return a cache whose blocks and RRPVs live in the
+// mapping. The cache geometry and policy are taken from the snapshot; the
+// write buffer is not part of it and starts empty with the default write
+// handling (see configureWrites()).
+Cache *loadCache(const char *snapshot_file);
+
+#endif
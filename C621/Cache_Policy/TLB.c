@@ -0,0 +1,363 @@
+#include "TLB.h"
+
+/* Defaults */
+static const Page_Policy page_policy = PAGES_4K;
+static const unsigned thp_threshold = 64; // Of the 512 4KB pages in a region
+
+static const unsigned l1_entries[3] = {64, 32, 4}; // 4KB, 2MB, 1GB
+static const unsigned l1_ways[3] = {4, 4, 4};
+static const unsigned stlb_entries = 1536;
+static const unsigned stlb_ways = 12;
+static const unsigned stlb_1g_entries = 16;
+static const unsigned stlb_1g_ways = 4;
+static const unsigned pwc_entries[PAGE_LEVELS - 1] = {2, 4, 32}; // PML4E, PDPTE, PDE
+
+static const char *page_policy_names[] = {"4k", "2m", "1g", "thp"};
+static const unsigned page_shift[3] = {12, 21, 30};
+
+#define THP_REGIONS 1024 // Initial capacity of the region hash, doubles at 3/4 load
+
+void initTLBConfig(TLB_Config *config)
+{
+    config->policy = page_policy;
+    config->thp_threshold = thp_threshold;
+
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        config->l1_entries[i] = l1_entries[i];
+        config->l1_ways[i] = l1_ways[i];
+    }
+    config->stlb_entries = stlb_entries;
+    config->stlb_ways = stlb_ways;
+    config->stlb_1g_entries = stlb_1g_entries;
+    config->stlb_1g_ways = stlb_1g_ways;
+
+    for (i = 0; i < PAGE_LEVELS - 1; i++)
+    {
+        config->pwc_entries[i] = pwc_entries[i];
+    }
+}
+
+Page_Policy parsePagePolicy(const char *name)
+{
+    int i;
+    for (i = 0; i < sizeof(page_policy_names) / sizeof(page_policy_names[0]); i++)
+    {
+        if (strcmp(name, page_policy_names[i]) == 0)
+        {
+            return (Page_Policy)i;
+        }
+    }
+
+    return (Page_Policy)-1;
+}
+
+const char *pagePolicyName(Page_Policy policy)
+{
+    return page_policy_names[policy];
+}
+
+/* Set-associative arrays */
+static void initArray(TLB_Array *array, unsigned entries, unsigned ways)
+{
+    if (ways == 0 || ways > entries)
+    {
+        ways = entries;
+    }
+    array->num_ways = ways;
+    array->num_sets = entries / ways;
+    array->entries = (TLB_Entry *)malloc(entries * sizeof(TLB_Entry));
+
+    unsigned i;
+    for (i = 0; i < entries; i++)
+    {
+        array->entries[i].tag = TLB_INVALID;
+        array->entries[i].when_touched = 0;
+    }
+}
+
+static bool lookupArray(TLB_Array *array, uint64_t index, uint64_t tag, uint64_t time)
+{
+    TLB_Entry *ways = &(array->entries[(index % array->num_sets) * array->num_ways]);
+
+    unsigned i;
+    for (i = 0; i < array->num_ways; i++)
+    {
+        if (ways[i].tag == tag)
+        {
+            ways[i].when_touched = time;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Insert a missing tag over an empty or the LRU entry
+static void fillArray(TLB_Array *array, uint64_t index, uint64_t tag, uint64_t time)
+{
+    TLB_Entry *ways = &(array->entries[(index % array->num_sets) * array->num_ways]);
+
+    TLB_Entry *victim = &(ways[0]);
+    unsigned i;
+    for (i = 0; i < array->num_ways && victim->tag != TLB_INVALID; i++)
+    {
+        if (ways[i].tag == TLB_INVALID || ways[i].when_touched < victim->when_touched)
+        {
+            victim = &(ways[i]);
+        }
+    }
+
+    victim->tag = tag;
+    victim->when_touched = time;
+}
+
+TLB *initTLB(const TLB_Config *config)
+{
+    TLB *tlb = (TLB *)calloc(1, sizeof(TLB));
+    tlb->config = *config;
+
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        initArray(&(tlb->l1[i]), config->l1_entries[i], config->l1_ways[i]);
+    }
+    initArray(&(tlb->stlb), config->stlb_entries, config->stlb_ways);
+    initArray(&(tlb->stlb_1g), config->stlb_1g_entries, config->stlb_1g_ways);
+    for (i = 0; i < PAGE_LEVELS - 1; i++)
+    {
+        initArray(&(tlb->pwc[i]), config->pwc_entries[i], 0);
+    }
+
+    if (config->policy == PAGES_THP)
+    {
+        tlb->region_capacity = THP_REGIONS;
+        tlb->regions = (THP_Region *)calloc(THP_REGIONS, sizeof(THP_Region));
+        uint64_t r;
+        for (r = 0; r < THP_REGIONS; r++)
+        {
+            tlb->regions[r].region = TLB_INVALID;
+        }
+    }
+
+    return tlb;
+}
+
+void freeTLB(TLB *tlb)
+{
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        free(tlb->l1[i].entries);
+    }
+    free(tlb->stlb.entries);
+    free(tlb->stlb_1g.entries);
+    for (i = 0; i < PAGE_LEVELS - 1; i++)
+    {
+        free(tlb->pwc[i].entries);
+    }
+    free(tlb->regions);
+    free(tlb);
+}
+
+/* Page size policy */
+static inline uint64_t hashKey(uint64_t key)
+{
+    return key * 0x9E3779B97F4A7C15ULL;
+}
+
+static THP_Region *findRegion(TLB *tlb, uint64_t region)
+{
+    uint64_t mask = tlb->region_capacity - 1;
+    uint64_t slot = (hashKey(region) >> 32) & mask;
+    while (tlb->regions[slot].region != TLB_INVALID && tlb->regions[slot].region != region)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    if (tlb->regions[slot].region == TLB_INVALID)
+    {
+        if ((tlb->num_regions + 1) * 4 > tlb->region_capacity * 3)
+        {
+            // Rehash into twice the slots
+            THP_Region *old = tlb->regions;
+            uint64_t old_capacity = tlb->region_capacity;
+
+            tlb->region_capacity *= 2;
+            tlb->regions = (THP_Region *)calloc(tlb->region_capacity, sizeof(THP_Region));
+            mask = tlb->region_capacity - 1;
+
+            uint64_t i;
+            for (i = 0; i < tlb->region_capacity; i++)
+            {
+                tlb->regions[i].region = TLB_INVALID;
+            }
+            for (i = 0; i < old_capacity; i++)
+            {
+                if (old[i].region == TLB_INVALID)
+                {
+                    continue;
+                }
+                uint64_t s = (hashKey(old[i].region) >> 32) & mask;
+                while (tlb->regions[s].region != TLB_INVALID)
+                {
+                    s = (s + 1) & mask;
+                }
+                tlb->regions[s] = old[i];
+            }
+            free(old);
+
+            return findRegion(tlb, region);
+        }
+
+        tlb->regions[slot].region = region;
+        ++tlb->num_regions;
+    }
+
+    return &(tlb->regions[slot]);
+}
+
+static Page_Size pageSize(TLB *tlb, uint64_t vaddr)
+{
+    switch (tlb->config.policy)
+    {
+        case PAGES_2M: return PAGE_2M;
+        case PAGES_1G: return PAGE_1G;
+        case PAGES_4K: return PAGE_4K;
+        default: break;
+    }
+
+    THP_Region *region = findRegion(tlb, vaddr >> page_shift[PAGE_2M]);
+    if (region->num_touched >= tlb->config.thp_threshold)
+    {
+        return PAGE_2M;
+    }
+
+    unsigned page = (vaddr >> page_shift[PAGE_4K]) & 511;
+    if (!(region->touched[page / 64] >> (page % 64) & 1))
+    {
+        region->touched[page / 64] |= 1ULL << (page % 64);
+        if (++region->num_touched == tlb->config.thp_threshold)
+        {
+            ++tlb->stats.promotions;
+            return PAGE_2M;
+        }
+    }
+    return PAGE_4K;
+}
+
+/* Page walk */
+// Physical address of the level's entry for vaddr (level 0 is the PML4)
+static uint64_t entryAddress(unsigned level, uint64_t vaddr)
+{
+    uint64_t table = level == 0 ? 0 : vaddr >> (48 - 9 * level);
+    uint64_t index = (vaddr >> (39 - 9 * level)) & 511;
+    uint64_t frame = (hashKey(table * PAGE_LEVELS + level) >> 34) & (PAGE_TABLE_FRAMES - 1);
+
+    return PAGE_TABLE_REGION + (frame << 12) + index * 8;
+}
+
+static void walkPageTable(TLB *tlb, Cache *cache, Request *req, uint64_t vaddr, Page_Size size,
+                          uint64_t access_time)
+{
+    unsigned leaf = PAGE_LEVELS - 1 - size; // PT for 4KB, PD for 2MB, PDPT for 1GB
+
+    // The deepest cached non-leaf entry skips the levels above it
+    unsigned start = 0;
+    int level;
+    for (level = leaf - 1; level >= 0; level--)
+    {
+        uint64_t prefix = vaddr >> (39 - 9 * level);
+        if (lookupArray(&(tlb->pwc[level]), prefix, prefix, tlb->time))
+        {
+            ++tlb->stats.pwc_hits[level];
+            start = level + 1;
+            break;
+        }
+    }
+
+    for (level = start; level <= leaf; level++)
+    {
+        if (level < leaf)
+        {
+            uint64_t prefix = vaddr >> (39 - 9 * level);
+            fillArray(&(tlb->pwc[level]), prefix, prefix, tlb->time);
+        }
+
+        ++tlb->stats.walk_refs;
+        if (cache == NULL)
+        {
+            continue;
+        }
+
+        Request walk_req;
+        walk_req.req_type = LOAD;
+        walk_req.load_or_store_addr = entryAddress(level, vaddr);
+        walk_req.PC = 0; // The page walker, not an instruction
+        walk_req.core_id = req->core_id;
+        walk_req.size = 8;
+
+        if (accessBlock(cache, &walk_req, access_time))
+        {
+            ++tlb->stats.walk_hits;
+        }
+        else
+        {
+            uint64_t wb_addr;
+            insertBlock(cache, &walk_req, access_time, &wb_addr);
+        }
+    }
+}
+
+void translateRequest(TLB *tlb, Cache *cache, Request *req, uint64_t access_time)
+{
+    uint64_t vaddr = req->load_or_store_addr & ((1ULL << 48) - 1);
+
+    ++tlb->time;
+    ++tlb->stats.accesses;
+
+    Page_Size size = pageSize(tlb, vaddr);
+    ++tlb->stats.pages[size];
+
+    uint64_t vpn = vaddr >> page_shift[size];
+    uint64_t tag = (vpn << 2) | size;
+    if (lookupArray(&(tlb->l1[size]), vpn, tag, tlb->time))
+    {
+        return;
+    }
+    ++tlb->stats.l1_misses;
+
+    TLB_Array *stlb = size == PAGE_1G ? &(tlb->stlb_1g) : &(tlb->stlb);
+    if (!lookupArray(stlb, vpn, tag, tlb->time))
+    {
+        ++tlb->stats.stlb_misses;
+        walkPageTable(tlb, cache, req, vaddr, size, access_time);
+        fillArray(stlb, vpn, tag, tlb->time);
+    }
+    fillArray(&(tlb->l1[size]), vpn, tag, tlb->time);
+}
+
+void printTLBStats(TLB *tlb)
+{
+    TLB_Stats *stats = &(tlb->stats);
+
+    printf("Pages: %s, %"PRIu64" 4KB, %"PRIu64" 2MB, %"PRIu64" 1GB translations",
+           pagePolicyName(tlb->config.policy), stats->pages[PAGE_4K], stats->pages[PAGE_2M],
+           stats->pages[PAGE_1G]);
+    if (tlb->config.policy == PAGES_THP)
+    {
+        printf(" (%"PRIu64" regions promoted)", stats->promotions);
+    }
+    printf("\n");
+
+    printf("dTLB miss rate: %lf%% (%"PRIu64" misses)\n",
+           stats->accesses ? 100.0 * stats->l1_misses / stats->accesses : 0, stats->l1_misses);
+    printf("STLB miss rate: %lf%% (%"PRIu64" page walks)\n",
+           stats->l1_misses ? 100.0 * stats->stlb_misses / stats->l1_misses : 0,
+           stats->stlb_misses);
+    printf("Page walk references: %"PRIu64" (%.2f per walk), %lf%% hit in the cache\n",
+           stats->walk_refs, stats->stlb_misses ? (double)stats->walk_refs / stats->stlb_misses : 0,
+           stats->walk_refs ? 100.0 * stats->walk_hits / stats->walk_refs : 0);
+    printf("Paging-structure cache hits: %"PRIu64" PML4E, %"PRIu64" PDPTE, %"PRIu64" PDE\n",
+           stats->pwc_hits[0], stats->pwc_hits[1], stats->pwc_hits[2]);
+}
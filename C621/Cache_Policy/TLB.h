@@ -0,0 +1,116 @@
+#ifndef __TLB_H__
+#define __TLB_H__
+
+#include "Cache.h"
+
+// Address translation in front of the data cache. The trace addresses are
+// virtual; every request is translated before the cache sees it, and the
+// page table entries a walk reads are loads to the same cache.
+//
+// Lookup goes L1 dTLB, then STLB, then a page walk over the x86-64
+// four-level table (PML4, PDPT, PD, PT). A 4KB page takes four references,
+// a 2MB page three and a 1GB page two. Paging-structure caches hold the
+// upper-level entries of recent walks, so a walk starts at the deepest
+// level they cover.
+//
+// Page tables are not in the trace. Each table gets a frame in a region
+// above the user address space, hashed from its level and the virtual
+// address bits above it, so neighbouring entries share cache blocks as
+// they would in memory.
+typedef enum Page_Size{PAGE_4K, PAGE_2M, PAGE_1G}Page_Size;
+
+// Fixed page size, or transparent huge pages: a 2MB region is mapped by
+// 4KB pages until thp_threshold of them are touched, then by one 2MB page
+typedef enum Page_Policy{PAGES_4K, PAGES_2M, PAGES_1G, PAGES_THP}Page_Policy;
+
+#define PAGE_LEVELS 4 // PML4, PDPT, PD, PT
+#define PAGE_TABLE_REGION 0xFFFF800000000000ULL // Kernel half, never in a user trace
+#define PAGE_TABLE_FRAMES (1ULL << 30) // Frames the table hash spreads over
+#define TLB_INVALID UINT64_MAX
+
+typedef struct TLB_Entry
+{
+    uint64_t tag; // Virtual page number of its size, TLB_INVALID if empty
+    uint64_t when_touched;
+}TLB_Entry;
+
+// Set-associative, LRU
+typedef struct TLB_Array
+{
+    TLB_Entry *entries;
+    unsigned num_sets;
+    unsigned num_ways;
+}TLB_Array;
+
+typedef struct TLB_Config
+{
+    Page_Policy policy;
+    unsigned thp_threshold; // 4KB pages touched before a region is promoted
+
+    // L1 dTLB, one array per page size
+    unsigned l1_entries[3];
+    unsigned l1_ways[3];
+
+    // STLB, 4KB and 2MB pages share one array, 1GB pages have their own
+    unsigned stlb_entries;
+    unsigned stlb_ways;
+    unsigned stlb_1g_entries;
+    unsigned stlb_1g_ways;
+
+    // Fully-associative paging-structure caches for PML4, PDPT and PD entries
+    unsigned pwc_entries[PAGE_LEVELS - 1];
+}TLB_Config;
+
+// A 2MB region under the THP policy
+typedef struct THP_Region
+{
+    uint64_t region; // Virtual address >> 21, TLB_INVALID for a free slot
+    uint64_t touched[8]; // 4KB pages seen, 512 bits
+    unsigned num_touched;
+}THP_Region;
+
+typedef struct TLB_Stats
+{
+    uint64_t accesses;
+    uint64_t l1_misses;
+    uint64_t stlb_misses; // Page walks
+    uint64_t pages[3]; // Translations by page size
+    uint64_t walk_refs; // Page table entries read
+    uint64_t walk_hits; // ... that hit in the data cache
+    uint64_t pwc_hits[PAGE_LEVELS - 1];
+    uint64_t promotions; // THP regions promoted to 2MB
+}TLB_Stats;
+
+typedef struct TLB
+{
+    TLB_Config config;
+
+    TLB_Array l1[3];
+    TLB_Array stlb;
+    TLB_Array stlb_1g;
+    TLB_Array pwc[PAGE_LEVELS - 1];
+
+    THP_Region *regions; // Open-addressing hash, THP policy only
+    uint64_t region_capacity;
+    uint64_t num_regions;
+
+    uint64_t time; // LRU clock
+
+    TLB_Stats stats;
+}TLB;
+
+// Defaults: Skylake-like sizes, 4KB pages
+void initTLBConfig(TLB_Config *config);
+Page_Policy parsePagePolicy(const char *name);
+const char *pagePolicyName(Page_Policy policy);
+
+TLB *initTLB(const TLB_Config *config);
+void freeTLB(TLB *tlb);
+
+// Translate req's address, sending any page walk references to cache
+// (none if it is NULL) as loads at access_time
+void translateRequest(TLB *tlb, Cache *cache, Request *req, uint64_t access_time);
+
+void printTLBStats(TLB *tlb);
+
+#endif
@@ -0,0 +1,359 @@
+#include "Cache.h"
+
+static inline uint64_t hashBlock(const Tag_Index *index, uint64_t blk_num)
+{
+    return (blk_num * 0x9E3779B97F4A7C15ULL) >> index->hash_shift;
+}
+
+// Block number of a valid block, its address >> set_shift
+static inline uint64_t blockNumber(const Cache *cache, const Cache_Block *blk)
+{
+    return (blk->tag << (cache->tag_shift - cache->set_shift)) | blk->set;
+}
+
+/* Victim order */
+// a is evicted before b
+static inline bool evictsBefore(const Cache *cache, const Cache_Block *a, const Cache_Block *b)
+{
+    if (a->valid != b->valid)
+    {
+        return !a->valid;
+    }
+    if (a->valid)
+    {
+        uint64_t key_a = cache->policy == POLICY_LFU ? a->frequency : a->when_touched;
+        uint64_t key_b = cache->policy == POLICY_LFU ? b->frequency : b->when_touched;
+        if (key_a != key_b)
+        {
+            return key_a < key_b;
+        }
+    }
+    return a->way < b->way;
+}
+
+static inline Cache_Block *heapBlock(const Cache *cache, uint32_t *heap, uint32_t set,
+                                     uint32_t pos)
+{
+    return &(cache->blocks[(uint64_t)set * cache->num_ways + heap[pos]]);
+}
+
+static inline void heapPlace(const Cache *cache, uint32_t *heap, uint32_t set, uint32_t pos,
+                             uint32_t way)
+{
+    heap[pos] = way;
+    cache->tag_index->heap_pos[(uint64_t)set * cache->num_ways + way] = pos;
+}
+
+// Move blk down from pos, the hole it leaves is filled on the way
+static void siftDown(Cache *cache, uint32_t *heap, uint32_t set, uint32_t pos, Cache_Block *blk)
+{
+    while (2 * pos + 1 < cache->num_ways)
+    {
+        uint32_t child = 2 * pos + 1;
+        if (child + 1 < cache->num_ways &&
+            evictsBefore(cache, heapBlock(cache, heap, set, child + 1),
+                         heapBlock(cache, heap, set, child)))
+        {
+            ++child;
+        }
+        if (!evictsBefore(cache, heapBlock(cache, heap, set, child), blk))
+        {
+            break;
+        }
+        heapPlace(cache, heap, set, pos, heap[child]);
+        pos = child;
+    }
+
+    heapPlace(cache, heap, set, pos, blk->way);
+}
+
+// Restore the order around blk's heap position after its key changed
+static void fixHeap(Cache *cache, Cache_Block *blk)
+{
+    Tag_Index *index = cache->tag_index;
+    uint32_t set = blk->set;
+    uint32_t *heap = &(index->heap[(uint64_t)set * cache->num_ways]);
+    uint32_t pos = index->heap_pos[(uint64_t)set * cache->num_ways + blk->way];
+
+    while (pos > 0 && evictsBefore(cache, blk, heapBlock(cache, heap, set, (pos - 1) / 2)))
+    {
+        heapPlace(cache, heap, set, pos, heap[(pos - 1) / 2]);
+        pos = (pos - 1) / 2;
+    }
+    siftDown(cache, heap, set, pos, blk);
+}
+
+/* Hash */
+static void insertSlot(Cache *cache, Cache_Block *blk)
+{
+    Tag_Index *index = cache->tag_index;
+    uint64_t mask = index->capacity - 1;
+    uint64_t slot = hashBlock(index, blockNumber(cache, blk));
+    while (index->slots[slot] >= 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    index->slots[slot] = blk - cache->blocks;
+}
+
+/* RRIP */
+#define RRPV_VALUES (RRPV_MAX + 1)
+#define FIELD_LOW_BITS 0x5555555555555555ULL
+
+// Low bit of every field of packed word w that belongs to a way
+static inline uint64_t usedFields(const Cache *cache, uint32_t w)
+{
+    unsigned fields = cache->num_ways - w * 32;
+    return fields >= 32 ? FIELD_LOW_BITS : FIELD_LOW_BITS & ((1ULL << (fields * RRPV_BITS)) - 1);
+}
+
+// Low bit of every field of packed word w that stores value
+static inline uint64_t fieldsHolding(const Cache *cache, uint64_t word, uint32_t w, unsigned value)
+{
+    uint64_t diff = word ^ (FIELD_LOW_BITS * value);
+    return ~(diff | (diff >> 1)) & usedFields(cache, w);
+}
+
+static inline uint64_t *rrpvSummary(const Cache *cache, uint32_t set, unsigned value)
+{
+    const Tag_Index *index = cache->tag_index;
+    return &(index->rrpv_summary[((uint64_t)set * RRPV_VALUES + value) * index->summary_words]);
+}
+
+// Counts and bitmaps over the stored RRPVs, with every offset at 0
+static void buildRRPVIndex(Cache *cache)
+{
+    Tag_Index *index = cache->tag_index;
+    memset(index->rrpv_age, 0, cache->num_sets * sizeof(uint8_t));
+    memset(index->rrpv_count, 0, (size_t)cache->num_sets * RRPV_VALUES * sizeof(uint32_t));
+    memset(index->rrpv_summary, 0,
+           (size_t)cache->num_sets * RRPV_VALUES * index->summary_words * sizeof(uint64_t));
+
+    uint32_t set, w;
+    unsigned value;
+    for (set = 0; set < cache->num_sets; set++)
+    {
+        const uint64_t *words = &(cache->rrpv[(uint64_t)set * cache->rrpv_words]);
+        for (w = 0; w < cache->rrpv_words; w++)
+        {
+            for (value = 0; value < RRPV_VALUES; value++)
+            {
+                uint64_t holding = fieldsHolding(cache, words[w], w, value);
+                if (holding != 0)
+                {
+                    index->rrpv_count[set * RRPV_VALUES + value] += __builtin_popcountll(holding);
+                    rrpvSummary(cache, set, value)[w / 64] |= 1ULL << (w % 64);
+                }
+            }
+        }
+    }
+}
+
+Tag_Index *initTagIndex(Cache *cache)
+{
+    Tag_Index *index = (Tag_Index *)malloc(sizeof(Tag_Index));
+    cache->tag_index = index;
+
+    index->capacity = 1;
+    while (index->capacity < 2 * (uint64_t)cache->num_blocks)
+    {
+        index->capacity <<= 1;
+    }
+    index->hash_shift = 64 - log2(index->capacity);
+    index->slots = (int32_t *)malloc(index->capacity * sizeof(int32_t));
+    memset(index->slots, -1, index->capacity * sizeof(int32_t));
+
+    index->heap = (uint32_t *)malloc(cache->num_blocks * sizeof(uint32_t));
+    index->heap_pos = (uint32_t *)malloc(cache->num_blocks * sizeof(uint32_t));
+
+    // A cold cache is already in order, a restored one is heapified per set
+    uint64_t i;
+    for (i = 0; i < cache->num_blocks; i++)
+    {
+        index->heap[i] = i % cache->num_ways;
+        index->heap_pos[i] = i % cache->num_ways;
+        if (cache->blocks[i].valid)
+        {
+            insertSlot(cache, &(cache->blocks[i]));
+        }
+    }
+
+    uint32_t set;
+    for (set = 0; set < cache->num_sets; set++)
+    {
+        uint32_t *heap = &(index->heap[(uint64_t)set * cache->num_ways]);
+        uint32_t pos;
+        for (pos = cache->num_ways / 2; pos-- > 0;)
+        {
+            siftDown(cache, heap, set, pos, heapBlock(cache, heap, set, pos));
+        }
+    }
+
+    index->summary_words = (cache->rrpv_words + 63) / 64;
+    index->rrpv_age = (uint8_t *)malloc(cache->num_sets * sizeof(uint8_t));
+    index->rrpv_count = (uint32_t *)malloc((size_t)cache->num_sets * RRPV_VALUES * sizeof(uint32_t));
+    index->rrpv_summary = (uint64_t *)malloc((size_t)cache->num_sets * RRPV_VALUES *
+                                             index->summary_words * sizeof(uint64_t));
+    buildRRPVIndex(cache);
+
+    return index;
+}
+
+void freeTagIndex(Tag_Index *index)
+{
+    free(index->slots);
+    free(index->heap);
+    free(index->heap_pos);
+    free(index->rrpv_age);
+    free(index->rrpv_count);
+    free(index->rrpv_summary);
+    free(index);
+}
+
+Cache_Block *findIndexedBlock(Cache *cache, uint64_t addr)
+{
+    Tag_Index *index = cache->tag_index;
+    uint64_t blk_num = addr >> cache->set_shift;
+    uint64_t mask = index->capacity - 1;
+    uint64_t slot = hashBlock(index, blk_num);
+    while (index->slots[slot] >= 0)
+    {
+        Cache_Block *blk = &(cache->blocks[index->slots[slot]]);
+        if (blockNumber(cache, blk) == blk_num)
+        {
+            return blk;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return NULL;
+}
+
+Cache_Block *indexedVictim(Cache *cache, uint64_t set_idx)
+{
+    return heapBlock(cache, &(cache->tag_index->heap[set_idx * cache->num_ways]), set_idx, 0);
+}
+
+void indexBlock(Cache *cache, Cache_Block *blk)
+{
+    insertSlot(cache, blk);
+    fixHeap(cache, blk);
+}
+
+// Later entries of the probe run shift back into the hole
+void unindexBlock(Cache *cache, Cache_Block *blk, uint64_t blk_addr)
+{
+    Tag_Index *index = cache->tag_index;
+    uint64_t mask = index->capacity - 1;
+    int32_t blk_idx = blk - cache->blocks;
+
+    uint64_t hole = hashBlock(index, blk_addr >> cache->set_shift);
+    while (index->slots[hole] != blk_idx)
+    {
+        hole = (hole + 1) & mask;
+    }
+
+    uint64_t next = (hole + 1) & mask;
+    while (index->slots[next] >= 0)
+    {
+        uint64_t home = hashBlock(index, blockNumber(cache, &(cache->blocks[index->slots[next]])));
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            index->slots[hole] = index->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    index->slots[hole] = -1;
+
+    fixHeap(cache, blk);
+}
+
+void touchIndexedBlock(Cache *cache, Cache_Block *blk)
+{
+    fixHeap(cache, blk);
+}
+
+Cache_Block *indexedRRIPVictim(Cache *cache, uint64_t set_idx)
+{
+    Tag_Index *index = cache->tag_index;
+    unsigned age = index->rrpv_age[set_idx];
+
+    // The highest RRPV some way holds
+    unsigned rrpv = RRPV_MAX;
+    unsigned value = (rrpv - age) & RRPV_MAX;
+    while (index->rrpv_count[set_idx * RRPV_VALUES + value] == 0)
+    {
+        --rrpv;
+        value = (rrpv - age) & RRPV_MAX;
+    }
+
+    // Its lowest way
+    const uint64_t *summary = rrpvSummary(cache, set_idx, value);
+    uint32_t s = 0;
+    while (summary[s] == 0)
+    {
+        ++s;
+    }
+    uint32_t w = s * 64 + __builtin_ctzll(summary[s]);
+    uint64_t word = cache->rrpv[set_idx * cache->rrpv_words + w];
+    uint32_t way = w * 32 + __builtin_ctzll(fieldsHolding(cache, word, w, value)) / RRPV_BITS;
+
+    // Age every way by the gap to RRPV_MAX
+    index->rrpv_age[set_idx] = (age + RRPV_MAX - rrpv) & RRPV_MAX;
+
+    return &(cache->blocks[set_idx * cache->num_ways + way]);
+}
+
+unsigned getIndexedRRPV(Cache *cache, uint32_t set, uint32_t way)
+{
+    uint64_t word = cache->rrpv[(uint64_t)set * cache->rrpv_words + way / 32];
+    unsigned value = (word >> ((way % 32) * RRPV_BITS)) & RRPV_MAX;
+
+    return (value + cache->tag_index->rrpv_age[set]) & RRPV_MAX;
+}
+
+void setIndexedRRPV(Cache *cache, uint32_t set, uint32_t way, unsigned rrpv)
+{
+    Tag_Index *index = cache->tag_index;
+    uint32_t w = way / 32;
+    uint64_t *word = &(cache->rrpv[(uint64_t)set * cache->rrpv_words + w]);
+    unsigned shift = (way % 32) * RRPV_BITS;
+
+    unsigned old_value = (*word >> shift) & RRPV_MAX;
+    unsigned value = (rrpv - index->rrpv_age[set]) & RRPV_MAX;
+    if (value == old_value)
+    {
+        return;
+    }
+    *word = (*word & ~((uint64_t)RRPV_MAX << shift)) | ((uint64_t)value << shift);
+
+    --index->rrpv_count[set * RRPV_VALUES + old_value];
+    ++index->rrpv_count[set * RRPV_VALUES + value];
+    if (fieldsHolding(cache, *word, w, old_value) == 0)
+    {
+        rrpvSummary(cache, set, old_value)[w / 64] &= ~(1ULL << (w % 64));
+    }
+    rrpvSummary(cache, set, value)[w / 64] |= 1ULL << (w % 64);
+}
+
+void settleIndexedRRPVs(Cache *cache)
+{
+    uint32_t set, way;
+    for (set = 0; set < cache->num_sets; set++)
+    {
+        if (cache->tag_index->rrpv_age[set] == 0)
+        {
+            continue;
+        }
+        for (way = 0; way < cache->num_ways; way++)
+        {
+            unsigned rrpv = getIndexedRRPV(cache, set, way);
+            uint64_t *word = &(cache->rrpv[(uint64_t)set * cache->rrpv_words + way / 32]);
+            unsigned shift = (way % 32) * RRPV_BITS;
+            *word = (*word & ~((uint64_t)RRPV_MAX << shift)) | ((uint64_t)rrpv << shift);
+        }
+        cache->tag_index->rrpv_age[set] = 0;
+    }
+    buildRRPVIndex(cache);
+}
@@ -0,0 +1,72 @@
+#ifndef __TAG_INDEX_H__
+#define __TAG_INDEX_H__
+
+#include "Cache_Blk.h"
+
+struct Cache;
+
+// Lookup and victim search for very wide sets, where scanning the ways
+// costs O(assoc) per access. Caches with TAG_INDEX_MIN_WAYS ways or more
+// (fully-associative ones included) get one, smaller ones keep the way
+// scan or a Cache_Engine.
+//
+// An open-addressing hash maps the block number (address >> set_shift) of
+// every valid block to its index in Cache::blocks, so lookup is O(1). Each
+// set keeps its ways in a binary min-heap in victim order: invalid blocks
+// first, then the smallest when_touched (LRU) or frequency (LFU), ties to
+// the lower way. That is the block the way scan in lru() and lfu() picks,
+// so results do not change; the heap root is it, and a touch or a fill
+// restores the order in O(log assoc).
+//
+// RRIP policies take an invalid heap root first too. Otherwise rrip()
+// wants the lowest way with the highest RRPV, after ageing the whole set
+// by the gap to RRPV_MAX. Each set keeps an ageing offset instead: its
+// packed RRPVs (Cache::rrpv) hold (RRPV - age) & RRPV_MAX, so ageing only
+// adds to the offset. Per set and stored value, a count says whether any
+// way holds it and a bitmap marks the packed words (32 ways each) that do,
+// so the victim is found from the highest RRPV with a non-zero count, the
+// first marked word and the first matching field, reading assoc / 2048
+// bitmap words at most. getRRPV() and setRRPV() apply the offset and keep
+// the counts and bitmaps; a snapshot is written with the offsets folded
+// back in (settleIndexedRRPVs()).
+#define TAG_INDEX_MIN_WAYS 128 // Below it the way scan is as fast
+
+typedef struct Tag_Index
+{
+    int32_t *slots; // Block index, -1 if empty
+    uint64_t capacity; // Slots, a power of two, at least twice the blocks
+    unsigned hash_shift;
+
+    uint32_t *heap; // Per set, num_ways ways in victim order
+    uint32_t *heap_pos; // Per block, its position in its set's heap
+
+    // RRIP
+    uint8_t *rrpv_age; // Per set, added to the stored RRPVs
+    uint32_t *rrpv_count; // Per set and stored value, ways holding it
+    uint64_t *rrpv_summary; // Per set and stored value, a bit per packed word holding it
+    unsigned summary_words; // Per set and stored value
+}Tag_Index;
+
+// Index over the cache's current blocks, policy and geometry
+Tag_Index *initTagIndex(struct Cache *cache);
+void freeTagIndex(Tag_Index *index);
+
+Cache_Block *findIndexedBlock(struct Cache *cache, uint64_t addr);
+Cache_Block *indexedVictim(struct Cache *cache, uint64_t set_idx);
+
+// blk was just filled
+void indexBlock(struct Cache *cache, Cache_Block *blk);
+// blk held blk_addr and was just invalidated
+void unindexBlock(struct Cache *cache, Cache_Block *blk, uint64_t blk_addr);
+// blk's when_touched or frequency changed
+void touchIndexedBlock(struct Cache *cache, Cache_Block *blk);
+
+// The lowest way with the highest RRPV of a set whose ways are all valid,
+// after ageing the set so that RRPV reaches RRPV_MAX
+Cache_Block *indexedRRIPVictim(struct Cache *cache, uint64_t set_idx);
+unsigned getIndexedRRPV(struct Cache *cache, uint32_t set, uint32_t way);
+void setIndexedRRPV(struct Cache *cache, uint32_t set, uint32_t way, unsigned rrpv);
+// Store the real RRPVs and zero every offset, as the snapshot format wants
+void settleIndexedRRPVs(struct Cache *cache);
+
+#endif
@@ -4,7 +4,27 @@ TraceParser *initTraceParser(const char * mem_file)
 {
     TraceParser *trace_parser = (TraceParser *)malloc(sizeof(TraceParser));
 
-    trace_parser->fd = fopen(mem_file, "r");
+    trace_parser->fd = NULL;
+    trace_parser->stream = NULL;
+
+    int stream_fd = openStreamSource(mem_file);
+    if (stream_fd >= 0)
+    {
+        trace_parser->stream = initStreamReader(stream_fd, MEM_STREAM_MAGIC, sizeof(Request_Record));
+        if (trace_parser->stream == NULL)
+        {
+            exit(1);
+        }
+    }
+    else
+    {
+        trace_parser->fd = fopen(mem_file, "r");
+        if (trace_parser->fd == NULL)
+        {
+            perror(mem_file);
+            exit(1);
+        }
+    }
     trace_parser->cur_req = (Request *)malloc(sizeof(Request));
 
     return trace_parser;
@@ -12,6 +32,27 @@ TraceParser *initTraceParser(const char * mem_file)
 
 bool getRequest(TraceParser *mem_trace)
 {
+    if (mem_trace->stream != NULL)
+    {
+        const Request_Record *record = (const Request_Record *)nextStreamRecord(mem_trace->stream);
+
+        if (record != NULL)
+        {
+            mem_trace->cur_req->req_type = (Request_Type)record->req_type;
+            mem_trace->cur_req->load_or_store_addr = record->load_or_store_addr;
+            mem_trace->cur_req->PC = record->PC;
+            mem_trace->cur_req->core_id = record->core_id;
+            mem_trace->cur_req->size = 0;
+            return true;
+        }
+
+        // Release memory
+        closeStreamReader(mem_trace->stream);
+        free(mem_trace->cur_req);
+        free(mem_trace);
+        return false;
+    }
+
     char *line = NULL;
     size_t len = 0;
     ssize_t read;
@@ -19,18 +60,19 @@ bool getRequest(TraceParser *mem_trace)
     if ((read = getline(&line, &len, mem_trace->fd)) != -1)
     {
 	char delim[] = " \n";
+	char *save; // strtok_r, so chunk workers can parse concurrently
 
-	char *ptr = strtok(line, delim);
+	char *ptr = strtok_r(line, delim, &save);
         // Extract core ID
         int core_id = atoi(ptr);
         // Extract PC
-        ptr = strtok(NULL, delim);
+        ptr = strtok_r(NULL, delim, &save);
         uint64_t PC = convToUint64(ptr);
         // Extract Load or Store Address
-        ptr = strtok(NULL, delim);
+        ptr = strtok_r(NULL, delim, &save);
         uint64_t load_or_store_addr = convToUint64(ptr);
         // Extract Request Type
-        ptr = strtok(NULL, delim);
+        ptr = strtok_r(NULL, delim, &save);
         Request_Type req_type;
         if (strcmp(ptr, "L") == 0)
         {
@@ -45,6 +87,7 @@ bool getRequest(TraceParser *mem_trace)
         mem_trace->cur_req->load_or_store_addr = load_or_store_addr;
         mem_trace->cur_req->PC = PC;
         mem_trace->cur_req->core_id = core_id;
+        mem_trace->cur_req->size = 0; // Not in the trace format
 
         free(line);
         line = NULL;
@@ -61,6 +104,14 @@ bool getRequest(TraceParser *mem_trace)
     return false;
 }
 
+// Release a file parser that stops before the end of the trace
+void closeTraceParser(TraceParser *mem_trace)
+{
+    fclose(mem_trace->fd);
+    free(mem_trace->cur_req);
+    free(mem_trace);
+}
+
 // convert a string to a uint64_t number
 uint64_t convToUint64(char *ptr)
 {
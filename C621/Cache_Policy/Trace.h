@@ -7,17 +7,35 @@
 #include <string.h>
 
 #include "Request.h"
+#include "Stream.h"
+
+#define MEM_STREAM_MAGIC "MEMSTRM1"
+
+// Request as framed on a live stream (see Stream.h)
+typedef struct Request_Record
+{
+    uint64_t PC;
+    uint64_t load_or_store_addr;
+    int32_t core_id;
+    uint8_t req_type;
+    uint8_t pad[3];
+}Request_Record;
 
 typedef struct TraceParser
 {
     FILE *fd; // file descriptor for the trace file
 
+    Stream_Reader *stream; // live input instead of a trace file, NULL if none
+
     Request *cur_req; // current instruction
 }TraceParser;
 
 // Define functions
+// mem_file is a text trace, or a live framed stream: "-" (stdin),
+// "unix:<path>" or a FIFO
 TraceParser *initTraceParser(const char * mem_file);
 bool getRequest(TraceParser *mem_trace);
+void closeTraceParser(TraceParser *mem_trace);
 uint64_t convToUint64(char *ptr);
 void printMemRequest(Request *req);
 
@@ -0,0 +1,172 @@
+#include "Index.h"
+
+#include <sys/stat.h>
+
+typedef struct Index_Header
+{
+    char magic[8];
+    uint64_t stride;
+    uint64_t num_records;
+    uint64_t trace_size;
+    int64_t trace_mtime;
+    uint64_t num_entries;
+}Index_Header;
+
+static char *indexPath(const char *trace_file)
+{
+    char *path = (char *)malloc(strlen(trace_file) + 5);
+    sprintf(path, "%s.idx", trace_file);
+    return path;
+}
+
+// One sequential pass over the trace, noting the offset of every stride-th record
+static Trace_Index *buildTraceIndex(const char *trace_file)
+{
+    FILE *fd = fopen(trace_file, "r");
+    if (fd == NULL)
+    {
+        perror(trace_file);
+        return NULL;
+    }
+
+    Trace_Index *index = (Trace_Index *)malloc(sizeof(Trace_Index));
+    index->stride = INDEX_STRIDE;
+    index->num_records = 0;
+    index->num_entries = 0;
+
+    uint64_t capacity = 1024;
+    index->offsets = (uint64_t *)malloc(capacity * sizeof(uint64_t));
+
+    char *line = NULL;
+    size_t len = 0;
+    uint64_t offset = 0;
+    while (true)
+    {
+        if (index->num_records % index->stride == 0)
+        {
+            if (index->num_entries == capacity)
+            {
+                capacity *= 2;
+                index->offsets = (uint64_t *)realloc(index->offsets, capacity * sizeof(uint64_t));
+            }
+            index->offsets[index->num_entries++] = offset;
+        }
+
+        ssize_t read = getline(&line, &len, fd);
+        if (read == -1)
+        {
+            break;
+        }
+        offset += read;
+        ++index->num_records;
+    }
+
+    free(line);
+    fclose(fd);
+
+    return index;
+}
+
+Trace_Index *loadTraceIndex(const char *trace_file)
+{
+    struct stat st;
+    if (stat(trace_file, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        fprintf(stderr, "%s: only regular trace files can be indexed\n", trace_file);
+        return NULL;
+    }
+
+    char *path = indexPath(trace_file);
+    Index_Header header;
+
+    // Reuse the sidecar if it still describes this trace, with one entry per
+    // stride of records (every record takes at least a byte) and one past it
+    FILE *fd = fopen(path, "rb");
+    if (fd != NULL)
+    {
+        if (fread(&header, sizeof(header), 1, fd) == 1 &&
+            memcmp(header.magic, INDEX_MAGIC, 8) == 0 &&
+            header.trace_size == st.st_size && header.trace_mtime == st.st_mtime &&
+            header.stride > 0 && header.num_records <= header.trace_size &&
+            header.num_entries == header.num_records / header.stride + 1)
+        {
+            Trace_Index *index = (Trace_Index *)malloc(sizeof(Trace_Index));
+            index->stride = header.stride;
+            index->num_records = header.num_records;
+            index->num_entries = header.num_entries;
+            index->offsets = (uint64_t *)malloc(header.num_entries * sizeof(uint64_t));
+
+            if (fread(index->offsets, sizeof(uint64_t), header.num_entries, fd) == header.num_entries)
+            {
+                fclose(fd);
+                free(path);
+                return index;
+            }
+            freeTraceIndex(index);
+        }
+        fclose(fd);
+    }
+
+    Trace_Index *index = buildTraceIndex(trace_file);
+    if (index == NULL)
+    {
+        free(path);
+        return NULL;
+    }
+
+    // Failing to save only costs a rebuild next time
+    fd = fopen(path, "wb");
+    if (fd != NULL)
+    {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, INDEX_MAGIC, 8);
+        header.stride = index->stride;
+        header.num_records = index->num_records;
+        header.trace_size = st.st_size;
+        header.trace_mtime = st.st_mtime;
+        header.num_entries = index->num_entries;
+
+        fwrite(&header, sizeof(header), 1, fd);
+        fwrite(index->offsets, sizeof(uint64_t), index->num_entries, fd);
+        fclose(fd);
+    }
+    free(path);
+
+    return index;
+}
+
+void freeTraceIndex(Trace_Index *index)
+{
+    free(index->offsets);
+    free(index);
+}
+
+bool seekTraceParser(TraceParser *parser, const Trace_Index *index, uint64_t record)
+{
+    if (parser->fd == NULL || record > index->num_records)
+    {
+        return false;
+    }
+
+    uint64_t entry = record / index->stride;
+    if (fseeko(parser->fd, index->offsets[entry], SEEK_SET) != 0)
+    {
+        return false;
+    }
+
+    // Skip the rest of the way line by line
+    char *line = NULL;
+    size_t len = 0;
+    uint64_t i;
+    for (i = entry * index->stride; i < record; i++)
+    {
+        if (getline(&line, &len, parser->fd) == -1)
+        {
+            free(line);
+            return false;
+        }
+    }
+    free(line);
+
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef __INDEX_H__
+#define __INDEX_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Trace.h" // The including simulator's, for its TraceParser
+
+#define INDEX_MAGIC "TRIDX001"
+#define INDEX_STRIDE 16384 // Records between index entries
+
+// Seekable index of a text trace, kept next to it as "<trace>.idx":
+//   INDEX_MAGIC, uint64 stride, uint64 num_records,
+//   uint64 trace size, int64 trace mtime (to detect a changed trace),
+//   uint64 num_entries, then num_entries uint64 byte offsets.
+// Entry i is the offset of record i * stride; there is one entry past the
+// last full stride, so the end of the trace can be sought too.
+typedef struct Trace_Index
+{
+    uint64_t stride;
+    uint64_t num_records;
+    uint64_t num_entries;
+    uint64_t *offsets;
+}Trace_Index;
+
+// Load the sidecar index of a trace, building and saving it if it is
+// missing or stale. Returns NULL if the trace cannot be read.
+Trace_Index *loadTraceIndex(const char *trace_file);
+void freeTraceIndex(Trace_Index *index);
+
+// Position a (file) parser so the next record read is record
+bool seekTraceParser(TraceParser *parser, const Trace_Index *index, uint64_t record);
+
+#endif
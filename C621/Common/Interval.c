@@ -0,0 +1,156 @@
+#include "Interval.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void writeRecord(Interval_Writer *writer, Interval_Record *record)
+{
+    if (!writer->csv)
+    {
+        fwrite(record->fields, sizeof(double), writer->num_fields, writer->fd);
+        return;
+    }
+
+    int i;
+    for (i = 0; i < writer->num_fields; i++)
+    {
+        fprintf(writer->fd, i == 0 ? "%.17g" : ",%.17g", record->fields[i]);
+    }
+    fputc('\n', writer->fd);
+}
+
+static void *drainIntervals(void *arg)
+{
+    Interval_Writer *writer = (Interval_Writer *)arg;
+
+    pthread_mutex_lock(&writer->lock);
+    while (true)
+    {
+        while (writer->head == writer->tail && !writer->done)
+        {
+            pthread_cond_wait(&writer->not_empty, &writer->lock);
+        }
+        if (writer->head == writer->tail && writer->done)
+        {
+            break;
+        }
+
+        // Write everything queued so far outside the lock
+        unsigned head = writer->head;
+        unsigned tail = writer->tail;
+        pthread_mutex_unlock(&writer->lock);
+
+        for (; head != tail; head = (head + 1) % INTERVAL_RING_SIZE)
+        {
+            writeRecord(writer, &(writer->ring[head]));
+        }
+        // Flush per batch so the stream can be followed while the run is going
+        fflush(writer->fd);
+
+        pthread_mutex_lock(&writer->lock);
+        writer->head = head;
+        pthread_cond_signal(&writer->not_full);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+Interval_Writer *initIntervalWriter(const char *out_file, const char **field_names, unsigned num_fields)
+{
+    if (num_fields > INTERVAL_MAX_FIELDS)
+    {
+        fprintf(stderr, "Too many interval fields: %u\n", num_fields);
+        return NULL;
+    }
+
+    size_t len = strlen(out_file);
+    bool to_stdout = strcmp(out_file, "-") == 0;
+    bool csv = to_stdout || (len >= 4 && strcmp(out_file + len - 4, ".csv") == 0);
+
+    FILE *fd = to_stdout ? stdout : fopen(out_file, csv ? "w" : "wb");
+    if (fd == NULL)
+    {
+        perror(out_file);
+        return NULL;
+    }
+
+    Interval_Writer *writer = (Interval_Writer *)malloc(sizeof(Interval_Writer));
+    writer->fd = fd;
+    writer->csv = csv;
+    writer->num_fields = num_fields;
+    writer->ring = (Interval_Record *)malloc(INTERVAL_RING_SIZE * sizeof(Interval_Record));
+    writer->head = 0;
+    writer->tail = 0;
+    writer->done = false;
+
+    // Header
+    int i;
+    if (csv)
+    {
+        for (i = 0; i < num_fields; i++)
+        {
+            fprintf(fd, i == 0 ? "%s" : ",%s", field_names[i]);
+        }
+        fputc('\n', fd);
+    }
+    else
+    {
+        uint32_t n = num_fields;
+        fwrite(INTERVAL_MAGIC, 1, 8, fd);
+        fwrite(&n, sizeof(n), 1, fd);
+        for (i = 0; i < num_fields; i++)
+        {
+            char name[INTERVAL_NAME_LEN] = {0};
+            strncpy(name, field_names[i], INTERVAL_NAME_LEN - 1);
+            fwrite(name, 1, INTERVAL_NAME_LEN, fd);
+        }
+    }
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->not_empty, NULL);
+    pthread_cond_init(&writer->not_full, NULL);
+    pthread_create(&writer->thread, NULL, drainIntervals, writer);
+
+    return writer;
+}
+
+void pushInterval(Interval_Writer *writer, const double *fields)
+{
+    pthread_mutex_lock(&writer->lock);
+    // Only blocks if the sink falls a full ring behind
+    while ((writer->tail + 1) % INTERVAL_RING_SIZE == writer->head)
+    {
+        pthread_cond_wait(&writer->not_full, &writer->lock);
+    }
+    memcpy(writer->ring[writer->tail].fields, fields, writer->num_fields * sizeof(double));
+    writer->tail = (writer->tail + 1) % INTERVAL_RING_SIZE;
+    pthread_cond_signal(&writer->not_empty);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+void closeIntervalWriter(Interval_Writer *writer)
+{
+    pthread_mutex_lock(&writer->lock);
+    writer->done = true;
+    pthread_cond_signal(&writer->not_empty);
+    pthread_mutex_unlock(&writer->lock);
+
+    pthread_join(writer->thread, NULL);
+
+    if (writer->fd != stdout)
+    {
+        fclose(writer->fd);
+    }
+    else
+    {
+        fflush(stdout);
+    }
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->not_empty);
+    pthread_cond_destroy(&writer->not_full);
+    free(writer->ring);
+    free(writer);
+}
@@ -0,0 +1,49 @@
+#ifndef __INTERVAL_H__
+#define __INTERVAL_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define INTERVAL_MAGIC "IVLSTAT1"
+#define INTERVAL_MAX_FIELDS 16
+#define INTERVAL_NAME_LEN 16
+#define INTERVAL_RING_SIZE 1024
+
+// One per-interval record, all fields are stored as doubles so counters
+// and rates can share a single fixed-size layout.
+typedef struct Interval_Record
+{
+    double fields[INTERVAL_MAX_FIELDS];
+}Interval_Record;
+
+// Buffered interval sink. The simulation thread only copies a record into
+// the ring; formatting and I/O happen on a background thread.
+//
+// Sink formats (picked from the file name):
+//   *.csv or "-" : CSV with a header row ("-" is stdout)
+//   otherwise    : binary, INTERVAL_MAGIC, uint32 num_fields,
+//                  num_fields names of INTERVAL_NAME_LEN bytes,
+//                  then num_fields doubles per record
+typedef struct Interval_Writer
+{
+    FILE *fd;
+    bool csv;
+    unsigned num_fields;
+
+    Interval_Record *ring;
+    unsigned head; // next record to write out
+    unsigned tail; // next free slot
+    bool done;
+
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t thread;
+}Interval_Writer;
+
+Interval_Writer *initIntervalWriter(const char *out_file, const char **field_names, unsigned num_fields);
+void pushInterval(Interval_Writer *writer, const double *fields);
+void closeIntervalWriter(Interval_Writer *writer);
+
+#endif
@@ -0,0 +1,194 @@
+#include "Profile.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+Profile profile;
+
+static const char *phase_names[NUM_PROFILE_PHASES] = {"setup", "warmup", "run", "report"};
+static const char *stage_names[NUM_PROFILE_STAGES] = {"parse", "simulate"};
+static const char *counter_names[NUM_PROFILE_COUNTERS] = {"cycles", "instructions",
+                                                          "llc_misses", "branch_misses"};
+static const uint64_t counter_events[NUM_PROFILE_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                                              PERF_COUNT_HW_INSTRUCTIONS,
+                                                              PERF_COUNT_HW_CACHE_MISSES,
+                                                              PERF_COUNT_HW_BRANCH_MISSES};
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int openCounter(uint64_t event)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = event;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // Count the stream reader and interval writer threads too
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void readCounters(uint64_t *values)
+{
+    int i;
+    for (i = 0; i < NUM_PROFILE_COUNTERS; i++)
+    {
+        if (profile.counter_fd[i] < 0 ||
+            read(profile.counter_fd[i], &values[i], sizeof(uint64_t)) != sizeof(uint64_t))
+        {
+            values[i] = 0;
+        }
+    }
+}
+
+void initProfile(const char *tool)
+{
+    memset(&profile, 0, sizeof(profile));
+    profile.tool = tool;
+
+    int i;
+    for (i = 0; i < NUM_PROFILE_COUNTERS; i++)
+    {
+        profile.counter_fd[i] = openCounter(counter_events[i]);
+    }
+    if (profile.counter_fd[COUNTER_CYCLES] < 0)
+    {
+        fprintf(stderr, "Hardware counters unavailable (perf_event_open: %s)\n", strerror(errno));
+    }
+}
+
+void profileBegin(Profile_Phase phase)
+{
+    readCounters(profile.phase_start_counters);
+    profile.phase_start_ns = nowNs();
+}
+
+void profileEnd(Profile_Phase phase)
+{
+    profile.phase_ns[phase] += nowNs() - profile.phase_start_ns;
+
+    uint64_t values[NUM_PROFILE_COUNTERS];
+    readCounters(values);
+
+    int i;
+    for (i = 0; i < NUM_PROFILE_COUNTERS; i++)
+    {
+        profile.phase_counters[phase][i] += values[i] - profile.phase_start_counters[i];
+    }
+}
+
+void profileArmRecord()
+{
+    profile.sampling = true;
+    profile.mark_ns = nowNs();
+}
+
+void profileStage(Profile_Stage stage)
+{
+    uint64_t now = nowNs();
+    uint64_t latency = now - profile.mark_ns;
+    profile.mark_ns = now;
+
+    unsigned bucket = latency ? 64 - __builtin_clzll(latency) : 0;
+    if (bucket >= PROFILE_HIST_BUCKETS)
+    {
+        bucket = PROFILE_HIST_BUCKETS - 1;
+    }
+
+    profile.stage_ns[stage] += latency;
+    profile.stage_samples[stage]++;
+    profile.stage_hist[stage][bucket]++;
+
+    if (stage == NUM_PROFILE_STAGES - 1)
+    {
+        profile.sampling = false;
+    }
+}
+
+static void printCounter(FILE *out, Profile_Phase phase, Profile_Counter counter)
+{
+    if (profile.counter_fd[counter] < 0)
+    {
+        fprintf(out, "null");
+    }
+    else
+    {
+        fprintf(out, "%"PRIu64, profile.phase_counters[phase][counter]);
+    }
+}
+
+void reportProfile()
+{
+    FILE *out = stderr;
+    const char *out_file = getenv("PROFILE_OUTPUT");
+    if (out_file != NULL && (out = fopen(out_file, "w")) == NULL)
+    {
+        perror(out_file);
+        return;
+    }
+
+    fprintf(out, "{\n  \"tool\": \"%s\",\n  \"records\": %"PRIu64",\n", profile.tool, profile.records);
+    fprintf(out, "  \"sample_period\": %d,\n", PROFILE_SAMPLE_PERIOD);
+
+    int i, j;
+    fprintf(out, "  \"phases\": {\n");
+    for (i = 0; i < NUM_PROFILE_PHASES; i++)
+    {
+        fprintf(out, "    \"%s\": {\"ns\": %"PRIu64, phase_names[i], profile.phase_ns[i]);
+        for (j = 0; j < NUM_PROFILE_COUNTERS; j++)
+        {
+            fprintf(out, ", \"%s\": ", counter_names[j]);
+            printCounter(out, i, j);
+        }
+        fprintf(out, "}%s\n", i == NUM_PROFILE_PHASES - 1 ? "" : ",");
+    }
+    fprintf(out, "  },\n");
+
+    // Sampled stage latencies, extrapolated to the whole run
+    fprintf(out, "  \"stages\": {\n");
+    for (i = 0; i < NUM_PROFILE_STAGES; i++)
+    {
+        uint64_t samples = profile.stage_samples[i];
+        double mean = samples ? (double)profile.stage_ns[i] / samples : 0;
+
+        fprintf(out, "    \"%s\": {\"samples\": %"PRIu64", \"mean_ns\": %.1f, \"estimated_ns\": %.0f,\n",
+                stage_names[i], samples, mean, mean * profile.records);
+
+        // Buckets up to the last non-empty one, as [upper bound in ns, count]
+        int last = 0;
+        for (j = 0; j < PROFILE_HIST_BUCKETS; j++)
+        {
+            if (profile.stage_hist[i][j])
+            {
+                last = j;
+            }
+        }
+        fprintf(out, "     \"histogram_ns\": [");
+        for (j = 0; j <= last && samples; j++)
+        {
+            fprintf(out, "%s[%"PRIu64", %"PRIu64"]", j ? ", " : "",
+                    (uint64_t)1 << j, profile.stage_hist[i][j]);
+        }
+        fprintf(out, "]}%s\n", i == NUM_PROFILE_STAGES - 1 ? "" : ",");
+    }
+    fprintf(out, "  }\n}\n");
+
+    if (out != stderr)
+    {
+        fclose(out);
+    }
+}
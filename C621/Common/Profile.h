@@ -0,0 +1,96 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Opt-in self-profiling, built with "make PROFILE=1". Without it every
+// PROFILE_* macro below compiles to nothing.
+//
+// Phases are timed exactly around the coarse steps of a run. The per-record
+// stages (parsing the trace, simulating the record) are timed on one record
+// in PROFILE_SAMPLE_PERIOD only, so the clock reads do not dominate the loop
+// they are measuring. Hardware counters are read through perf_event_open on
+// the simulator process (including its reader/writer threads) at every phase
+// boundary; a counter the kernel refuses is reported as null.
+//
+// The JSON report goes to stderr, or to the file named by $PROFILE_OUTPUT.
+typedef enum Profile_Phase
+{
+    PHASE_SETUP,
+    PHASE_WARMUP,
+    PHASE_RUN,
+    PHASE_REPORT,
+    NUM_PROFILE_PHASES
+}Profile_Phase;
+
+typedef enum Profile_Stage
+{
+    STAGE_PARSE,
+    STAGE_SIMULATE, // Must stay the last stage of a record
+    NUM_PROFILE_STAGES
+}Profile_Stage;
+
+typedef enum Profile_Counter
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    NUM_PROFILE_COUNTERS
+}Profile_Counter;
+
+#ifdef PROFILE
+
+#define PROFILE_SAMPLE_PERIOD 64 // Power of two
+#define PROFILE_HIST_BUCKETS 40  // Bucket i holds latencies in [2^(i-1), 2^i) ns
+
+typedef struct Profile
+{
+    const char *tool;
+
+    uint64_t phase_ns[NUM_PROFILE_PHASES];
+    uint64_t phase_counters[NUM_PROFILE_PHASES][NUM_PROFILE_COUNTERS];
+    uint64_t phase_start_ns;
+    uint64_t phase_start_counters[NUM_PROFILE_COUNTERS];
+    int counter_fd[NUM_PROFILE_COUNTERS]; // -1 when unavailable
+
+    uint64_t records;
+    bool sampling;    // Timing the current record
+    uint64_t mark_ns; // End of the previous stage of the sampled record
+    uint64_t stage_ns[NUM_PROFILE_STAGES];
+    uint64_t stage_samples[NUM_PROFILE_STAGES];
+    uint64_t stage_hist[NUM_PROFILE_STAGES][PROFILE_HIST_BUCKETS];
+}Profile;
+
+extern Profile profile;
+
+void initProfile(const char *tool);
+void profileBegin(Profile_Phase phase);
+void profileEnd(Profile_Phase phase);
+void profileArmRecord();
+void profileStage(Profile_Stage stage);
+void reportProfile();
+
+#define PROFILE_INIT(tool) initProfile(tool)
+#define PROFILE_BEGIN(phase) profileBegin(phase)
+#define PROFILE_END(phase) profileEnd(phase)
+// Close a stage of the current record; only sampled records read the clock
+#define PROFILE_STAGE(stage) do { if (profile.sampling) profileStage(stage); } while (0)
+// End of a record, arms the sampling of the next one every period
+#define PROFILE_NEXT_RECORD() \
+    do { if ((++profile.records & (PROFILE_SAMPLE_PERIOD - 1)) == 0) profileArmRecord(); } while (0)
+#define PROFILE_REPORT() reportProfile()
+
+#else
+
+#define PROFILE_INIT(tool) ((void)0)
+#define PROFILE_BEGIN(phase) ((void)0)
+#define PROFILE_END(phase) ((void)0)
+#define PROFILE_STAGE(stage) ((void)0)
+#define PROFILE_NEXT_RECORD() ((void)0)
+#define PROFILE_REPORT() ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+#include "Space_Saving.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static inline unsigned hashKey(const Space_Saving *sketch, uint64_t key)
+{
+    return ((key * 0x9E3779B97F4A7C15ULL) >> 32) & sketch->index_mask;
+}
+
+Space_Saving *initSpaceSaving(unsigned num_slots)
+{
+    Space_Saving *sketch = (Space_Saving *)calloc(1, sizeof(Space_Saving));
+    sketch->num_slots = num_slots;
+
+    sketch->keys = (uint64_t *)calloc(num_slots, sizeof(uint64_t));
+    sketch->counts = (uint64_t *)calloc(num_slots, sizeof(uint64_t));
+    sketch->errors = (uint64_t *)calloc(num_slots, sizeof(uint64_t));
+    sketch->heap = (unsigned *)malloc(num_slots * sizeof(unsigned));
+    sketch->heap_pos = (unsigned *)malloc(num_slots * sizeof(unsigned));
+
+    unsigned index_size = 1;
+    while (index_size < 2 * num_slots)
+    {
+        index_size <<= 1;
+    }
+    sketch->index_mask = index_size - 1;
+    sketch->index = (int *)malloc(index_size * sizeof(int));
+    memset(sketch->index, -1, index_size * sizeof(int));
+
+    return sketch;
+}
+
+void freeSpaceSaving(Space_Saving *sketch)
+{
+    free(sketch->keys);
+    free(sketch->counts);
+    free(sketch->errors);
+    free(sketch->heap);
+    free(sketch->heap_pos);
+    free(sketch->index);
+    free(sketch);
+}
+
+/* Key index */
+int findSketchKey(const Space_Saving *sketch, uint64_t key)
+{
+    unsigned pos = hashKey(sketch, key);
+    while (sketch->index[pos] >= 0)
+    {
+        if (sketch->keys[sketch->index[pos]] == key)
+        {
+            return sketch->index[pos];
+        }
+        pos = (pos + 1) & sketch->index_mask;
+    }
+    return -1;
+}
+
+static void indexSlot(Space_Saving *sketch, unsigned slot)
+{
+    unsigned pos = hashKey(sketch, sketch->keys[slot]);
+    while (sketch->index[pos] >= 0)
+    {
+        pos = (pos + 1) & sketch->index_mask;
+    }
+    sketch->index[pos] = slot;
+}
+
+// Later entries of the probe run shift back into the hole
+static void unindexSlot(Space_Saving *sketch, unsigned slot)
+{
+    unsigned hole = hashKey(sketch, sketch->keys[slot]);
+    while (sketch->index[hole] != (int)slot)
+    {
+        hole = (hole + 1) & sketch->index_mask;
+    }
+
+    unsigned next = (hole + 1) & sketch->index_mask;
+    while (sketch->index[next] >= 0)
+    {
+        unsigned home = hashKey(sketch, sketch->keys[sketch->index[next]]);
+        if (((next - home) & sketch->index_mask) >= ((next - hole) & sketch->index_mask))
+        {
+            sketch->index[hole] = sketch->index[next];
+            hole = next;
+        }
+        next = (next + 1) & sketch->index_mask;
+    }
+    sketch->index[hole] = -1;
+}
+
+/* Min-heap on counts */
+static void heapSwap(Space_Saving *sketch, unsigned a, unsigned b)
+{
+    unsigned slot = sketch->heap[a];
+    sketch->heap[a] = sketch->heap[b];
+    sketch->heap[b] = slot;
+    sketch->heap_pos[sketch->heap[a]] = a;
+    sketch->heap_pos[sketch->heap[b]] = b;
+}
+
+static inline uint64_t heapKey(const Space_Saving *sketch, unsigned pos)
+{
+    return sketch->counts[sketch->heap[pos]];
+}
+
+static void siftUp(Space_Saving *sketch, unsigned pos)
+{
+    while (pos > 0 && heapKey(sketch, (pos - 1) / 2) > heapKey(sketch, pos))
+    {
+        heapSwap(sketch, pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+// Counts only grow, so a tracked slot only ever moves down
+static void siftDown(Space_Saving *sketch, unsigned pos)
+{
+    while (2 * pos + 1 < sketch->num_used)
+    {
+        unsigned child = 2 * pos + 1;
+        if (child + 1 < sketch->num_used && heapKey(sketch, child + 1) < heapKey(sketch, child))
+        {
+            ++child;
+        }
+        if (heapKey(sketch, pos) <= heapKey(sketch, child))
+        {
+            break;
+        }
+        heapSwap(sketch, pos, child);
+        pos = child;
+    }
+}
+
+unsigned admitSketchKey(Space_Saving *sketch, uint64_t key)
+{
+    unsigned slot;
+    uint64_t inherited = 0;
+    if (sketch->num_used < sketch->num_slots)
+    {
+        // A free slot starts at count 0, at the top of the heap
+        slot = sketch->num_used;
+        sketch->heap[slot] = slot;
+        sketch->heap_pos[slot] = slot;
+        sketch->counts[slot] = 0;
+        ++sketch->num_used;
+        siftUp(sketch, slot);
+    }
+    else
+    {
+        // Take over the key with the smallest count
+        slot = sketch->heap[0];
+        inherited = sketch->counts[slot];
+        unindexSlot(sketch, slot);
+    }
+
+    sketch->keys[slot] = key;
+    sketch->counts[slot] = inherited;
+    sketch->errors[slot] = inherited;
+    indexSlot(sketch, slot);
+
+    return slot;
+}
+
+void countSketchSlot(Space_Saving *sketch, unsigned slot)
+{
+    ++sketch->counts[slot];
+    siftDown(sketch, sketch->heap_pos[slot]);
+}
+
+/* Ranking */
+typedef struct Sketch_Rank
+{
+    uint64_t count;
+    uint64_t key;
+    unsigned slot;
+}Sketch_Rank;
+
+static int compareRanks(const void *a, const void *b)
+{
+    const Sketch_Rank *x = (const Sketch_Rank *)a;
+    const Sketch_Rank *y = (const Sketch_Rank *)b;
+
+    if (x->count != y->count)
+    {
+        return x->count < y->count ? 1 : -1;
+    }
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+unsigned *rankSketchSlots(const Space_Saving *sketch)
+{
+    Sketch_Rank *ranks = (Sketch_Rank *)malloc((sketch->num_used + 1) * sizeof(Sketch_Rank));
+    unsigned i;
+    for (i = 0; i < sketch->num_used; i++)
+    {
+        ranks[i].count = sketch->counts[i];
+        ranks[i].key = sketch->keys[i];
+        ranks[i].slot = i;
+    }
+    qsort(ranks, sketch->num_used, sizeof(Sketch_Rank), compareRanks);
+
+    unsigned *slots = (unsigned *)malloc((sketch->num_used + 1) * sizeof(unsigned));
+    for (i = 0; i < sketch->num_used; i++)
+    {
+        slots[i] = ranks[i].slot;
+    }
+    free(ranks);
+
+    return slots;
+}
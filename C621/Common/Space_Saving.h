@@ -0,0 +1,47 @@
+#ifndef __SPACE_SAVING_H__
+#define __SPACE_SAVING_H__
+
+#include <stdint.h>
+
+// Heavy hitters in fixed memory, whatever the number of distinct keys: a
+// space-saving sketch (Metwally et al., ICDT 2005). num_slots counters
+// track the keys counted most. A key that is not tracked takes over the
+// slot with the smallest count, inheriting that count as an overestimate
+// (its error). Every key counted more than total / num_slots times is
+// tracked.
+//
+// Slots sit in a min-heap on their count, found by key through an
+// open-addressing table of at least twice as many entries. Users keep
+// their own per-slot data in an array of num_slots entries, reset when
+// admitSketchKey() hands a slot to a new key.
+typedef struct Space_Saving
+{
+    unsigned num_slots;
+    unsigned num_used;
+
+    uint64_t *keys;
+    uint64_t *counts; // Estimate, includes error
+    uint64_t *errors; // Count inherited from the evicted key
+
+    unsigned *heap; // Slot indices, min-heap on counts
+    unsigned *heap_pos; // Per slot, its position in the heap
+    int *index; // Key hash to slot, -1 if empty
+    unsigned index_mask;
+}Space_Saving;
+
+Space_Saving *initSpaceSaving(unsigned num_slots);
+void freeSpaceSaving(Space_Saving *sketch);
+
+// Slot tracking key, -1 if none
+int findSketchKey(const Space_Saving *sketch, uint64_t key);
+// A slot for a key that is not tracked, a free one while there are any,
+// else the one with the smallest count; its count is not incremented
+unsigned admitSketchKey(Space_Saving *sketch, uint64_t key);
+// Count one more occurrence of the key in slot
+void countSketchSlot(Space_Saving *sketch, unsigned slot);
+
+// The num_used slots by decreasing count, then increasing key, in a new
+// array the caller frees
+unsigned *rankSketchSlots(const Space_Saving *sketch);
+
+#endif
@@ -0,0 +1,267 @@
+#include "Stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Read exactly len bytes, false on EOF or error
+static bool readFull(int fd, void *buf, size_t len)
+{
+    char *ptr = (char *)buf;
+    while (len > 0)
+    {
+        ssize_t n = read(fd, ptr, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        ptr += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool writeFull(int fd, const void *buf, size_t len)
+{
+    const char *ptr = (const char *)buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, ptr, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        ptr += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool unixAddress(const char *path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path))
+    {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return false;
+    }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+int openStreamSource(const char *source)
+{
+    if (strcmp(source, "-") == 0)
+    {
+        return STDIN_FILENO;
+    }
+
+    if (strncmp(source, "unix:", 5) == 0)
+    {
+        struct sockaddr_un addr;
+        if (!unixAddress(source + 5, &addr))
+        {
+            return -1;
+        }
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(addr.sun_path);
+        if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+            listen(listener, 1) != 0)
+        {
+            perror(source);
+            return -1;
+        }
+
+        // One producer per run
+        int fd = accept(listener, NULL, NULL);
+        close(listener);
+        unlink(addr.sun_path);
+        if (fd < 0)
+        {
+            perror(source);
+        }
+        return fd;
+    }
+
+    struct stat st;
+    if (stat(source, &st) == 0 && S_ISFIFO(st.st_mode))
+    {
+        return open(source, O_RDONLY);
+    }
+
+    return -1;
+}
+
+int openStreamSink(const char *sink)
+{
+    if (strcmp(sink, "-") == 0)
+    {
+        return STDOUT_FILENO;
+    }
+
+    if (strncmp(sink, "unix:", 5) == 0)
+    {
+        struct sockaddr_un addr;
+        if (!unixAddress(sink + 5, &addr))
+        {
+            return -1;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            perror(sink);
+            return -1;
+        }
+        return fd;
+    }
+
+    int fd = open(sink, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        perror(sink);
+    }
+    return fd;
+}
+
+static void *readFrames(void *arg)
+{
+    Stream_Reader *reader = (Stream_Reader *)arg;
+
+    uint32_t remaining = 0; // Records left in the frame on the wire
+    while (true)
+    {
+        if (remaining == 0 && (!readFull(reader->fd, &remaining, sizeof(remaining)) || remaining == 0))
+        {
+            break;
+        }
+
+        // Wait for a free queue slot
+        pthread_mutex_lock(&reader->lock);
+        while ((reader->tail + 1) % STREAM_QUEUE_FRAMES == reader->head)
+        {
+            pthread_cond_wait(&reader->not_full, &reader->lock);
+        }
+        unsigned slot = reader->tail;
+        pthread_mutex_unlock(&reader->lock);
+
+        // Wire frames larger than a slot are split across slots
+        uint32_t count = remaining < STREAM_FRAME_RECORDS ? remaining : STREAM_FRAME_RECORDS;
+        char *dst = reader->frames + (size_t)slot * STREAM_FRAME_RECORDS * reader->record_size;
+        if (!readFull(reader->fd, dst, count * reader->record_size))
+        {
+            fprintf(stderr, "Stream ended inside a frame\n");
+            break;
+        }
+        remaining -= count;
+
+        pthread_mutex_lock(&reader->lock);
+        reader->counts[slot] = count;
+        reader->tail = (slot + 1) % STREAM_QUEUE_FRAMES;
+        pthread_cond_signal(&reader->not_empty);
+        pthread_mutex_unlock(&reader->lock);
+    }
+
+    pthread_mutex_lock(&reader->lock);
+    reader->eof = true;
+    pthread_cond_signal(&reader->not_empty);
+    pthread_mutex_unlock(&reader->lock);
+
+    return NULL;
+}
+
+Stream_Reader *initStreamReader(int fd, const char *magic, size_t record_size)
+{
+    char header[STREAM_MAGIC_LEN];
+    if (!readFull(fd, header, STREAM_MAGIC_LEN) || memcmp(header, magic, STREAM_MAGIC_LEN) != 0)
+    {
+        fprintf(stderr, "Input is not a %.8s record stream\n", magic);
+        return NULL;
+    }
+
+    Stream_Reader *reader = (Stream_Reader *)calloc(1, sizeof(Stream_Reader));
+    reader->fd = fd;
+    reader->record_size = record_size;
+    reader->frames = (char *)malloc((size_t)STREAM_QUEUE_FRAMES * STREAM_FRAME_RECORDS * record_size);
+
+    pthread_mutex_init(&reader->lock, NULL);
+    pthread_cond_init(&reader->not_empty, NULL);
+    pthread_cond_init(&reader->not_full, NULL);
+    pthread_create(&reader->thread, NULL, readFrames, reader);
+
+    return reader;
+}
+
+const void *nextStreamRecord(Stream_Reader *reader)
+{
+    if (reader->holding && reader->pos < reader->counts[reader->head])
+    {
+        return reader->frames + ((size_t)reader->head * STREAM_FRAME_RECORDS + reader->pos++) * reader->record_size;
+    }
+
+    // Hand the finished frame back and wait for the next one
+    pthread_mutex_lock(&reader->lock);
+    if (reader->holding)
+    {
+        reader->head = (reader->head + 1) % STREAM_QUEUE_FRAMES;
+        reader->holding = false;
+        pthread_cond_signal(&reader->not_full);
+    }
+    while (reader->head == reader->tail && !reader->eof)
+    {
+        pthread_cond_wait(&reader->not_empty, &reader->lock);
+    }
+    bool available = reader->head != reader->tail;
+    pthread_mutex_unlock(&reader->lock);
+
+    if (!available)
+    {
+        return NULL;
+    }
+
+    reader->holding = true;
+    reader->pos = 0;
+    return nextStreamRecord(reader);
+}
+
+void closeStreamReader(Stream_Reader *reader)
+{
+    pthread_join(reader->thread, NULL);
+
+    if (reader->fd != STDIN_FILENO)
+    {
+        close(reader->fd);
+    }
+    pthread_mutex_destroy(&reader->lock);
+    pthread_cond_destroy(&reader->not_empty);
+    pthread_cond_destroy(&reader->not_full);
+    free(reader->frames);
+    free(reader);
+}
+
+bool writeStreamHeader(int fd, const char *magic)
+{
+    return writeFull(fd, magic, STREAM_MAGIC_LEN);
+}
+
+bool writeStreamFrame(int fd, const void *records, uint32_t count, size_t record_size)
+{
+    return writeFull(fd, &count, sizeof(count)) &&
+           writeFull(fd, records, (size_t)count * record_size);
+}
@@ -0,0 +1,61 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define STREAM_MAGIC_LEN 8
+#define STREAM_FRAME_RECORDS 4096 // Records per queued frame
+#define STREAM_QUEUE_FRAMES 8     // Frames buffered ahead of the simulator
+
+// Framed binary record stream, used for live input from a tracer:
+//   8-byte magic
+//   frames: uint32_t count, then count fixed-size records
+// A frame with count 0, or the end of the stream, ends it.
+//
+// A reader thread fills a bounded queue of frames. When the simulator falls
+// behind the queue fills up, the reader stops reading and the producer
+// blocks on the pipe or socket, which is the backpressure.
+typedef struct Stream_Reader
+{
+    int fd;
+    size_t record_size;
+
+    char *frames; // STREAM_QUEUE_FRAMES x STREAM_FRAME_RECORDS records
+    uint32_t counts[STREAM_QUEUE_FRAMES];
+    unsigned head; // Frame the simulator reads
+    unsigned tail; // Frame the reader fills next
+    bool eof;
+
+    // Simulator-side cursor into the head frame
+    bool holding;
+    uint32_t pos;
+
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_t thread;
+}Stream_Reader;
+
+// Open a live source: "-" is stdin, "unix:<path>" listens on a Unix socket
+// and accepts one producer, and a FIFO path is opened for reading.
+// Returns -1 for anything else (a regular trace file).
+int openStreamSource(const char *source);
+
+// Open a sink for a producer: "-" is stdout, "unix:<path>" connects to a
+// listening simulator, anything else is created as a file (or opened if it
+// is a FIFO).
+int openStreamSink(const char *sink);
+
+Stream_Reader *initStreamReader(int fd, const char *magic, size_t record_size);
+// Next record, NULL at the end of the stream
+const void *nextStreamRecord(Stream_Reader *reader);
+// Release the reader once nextStreamRecord() has returned NULL
+void closeStreamReader(Stream_Reader *reader);
+
+bool writeStreamHeader(int fd, const char *magic);
+bool writeStreamFrame(int fd, const void *records, uint32_t count, size_t record_size);
+
+#endif
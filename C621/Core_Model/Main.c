@@ -0,0 +1,240 @@
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "Trace.h"
+#include "Branch_Predictor.h"
+#include "Evaluate.h"
+#include "Mem_Port.h"
+#include "Profile.h"
+
+// Interval timing model defaults (in cycles)
+const unsigned dispatch_width = 4;       // Instructions issued per cycle between miss events
+const unsigned mispredict_penalty = 15;  // Front-end refill after a mispredicted branch
+const unsigned load_miss_penalty = 200;  // Load missing the data cache, paid in full
+const unsigned store_miss_penalty = 0;   // Stores retire into a store buffer
+
+const unsigned default_block_size = 64;
+const unsigned default_cache_size = 128;
+const unsigned default_assoc = 4;
+
+static void usage(const char *prog)
+{
+    printf("Usage: %s [-p <predictor>] [-b <block-bytes>] [-c <cache-KB>] [-a <assoc>]\n"
+           "       [-W <dispatch-width>] [-B <mispredict-penalty>] [-L <load-miss-penalty>]\n"
+           "       [-S <store-miss-penalty>] %s\n",
+           prog, "<cpu-trace>");
+    printf("  -p  branch predictor, type[:table-size[:history-bits[:threshold]]]\n");
+    printf("      (default perceptron)\n");
+    printf("  -b, -c, -a  data cache geometry (default %uB blocks, %uKB, %u-way)\n",
+           default_block_size, default_cache_size, default_assoc);
+    printf("  -W, -B, -L, -S  timing model (default %u-wide, %u, %u and %u cycles)\n",
+           dispatch_width, mispredict_penalty, load_miss_penalty, store_miss_penalty);
+}
+
+// A decimal count from 0 to max, anything else (signs included) is rejected
+static bool parseCount(const char *arg, unsigned max, unsigned *count)
+{
+    char *end;
+    errno = 0;
+    unsigned long value = strtoul(arg, &end, 10);
+    if (!isdigit((unsigned char)arg[0]) || *end != '\0' || errno != 0 || value > max)
+    {
+        return false;
+    }
+    *count = value;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    Predictor_Config predictor_config;
+    initPredictorConfig(&predictor_config, PERCEPTRON);
+
+    unsigned block_size = default_block_size;
+    unsigned cache_size = default_cache_size;
+    unsigned assoc = default_assoc;
+
+    unsigned width = dispatch_width;
+    unsigned branch_penalty = mispredict_penalty;
+    unsigned load_penalty = load_miss_penalty;
+    unsigned store_penalty = store_miss_penalty;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:b:c:a:W:B:L:S:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                if (!parsePredictorConfig(optarg, &predictor_config))
+                {
+                    return 1;
+                }
+                break;
+            case 'b':
+                if (!parseCount(optarg, UINT_MAX, &block_size))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'c':
+                if (!parseCount(optarg, UINT_MAX, &cache_size))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'a':
+                if (!parseCount(optarg, UINT_MAX, &assoc))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'W':
+                if (!parseCount(optarg, UINT_MAX, &width))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'B':
+                if (!parseCount(optarg, UINT_MAX, &branch_penalty))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'L':
+                if (!parseCount(optarg, UINT_MAX, &load_penalty))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            case 'S':
+                if (!parseCount(optarg, UINT_MAX, &store_penalty))
+                {
+                    usage(argv[0]);
+                    return 0;
+                }
+                break;
+            default: usage(argv[0]); return 0;
+        }
+    }
+
+    if (optind != argc - 1 || width == 0)
+    {
+        usage(argv[0]);
+
+        return 0;
+    }
+
+    // The data cache, checked before anything else is set up
+    Mem_Port *mem_port = initMemPort(block_size, cache_size, assoc);
+    if (mem_port == NULL)
+    {
+        usage(argv[0]);
+
+        return 0;
+    }
+
+    PROFILE_INIT("Core_Model");
+    PROFILE_BEGIN(PHASE_SETUP);
+
+    // Initialize a CPU trace parser
+    TraceParser *cpu_trace = initTraceParser(argv[optind]);
+
+    // Initialize the branch predictor
+    Branch_Predictor *branch_predictor = initBranchPredictorConfig(&predictor_config);
+
+    // Running the trace
+    uint64_t num_of_instructions = 0;
+    uint64_t num_of_branches = 0;
+    uint64_t num_of_incorrect_predictions = 0;
+
+    // Penalty cycles charged on top of the base dispatch rate
+    uint64_t branch_cycles = 0;
+    uint64_t memory_cycles = 0;
+
+    PROFILE_END(PHASE_SETUP);
+
+    PROFILE_BEGIN(PHASE_RUN);
+    while (getInstruction(cpu_trace))
+    {
+        PROFILE_STAGE(STAGE_PARSE);
+
+        Instruction *instr = cpu_trace->cur_instr;
+
+        // Time stamp for the cache replacement policies
+        uint64_t now = num_of_instructions / width + branch_cycles + memory_cycles;
+
+        if (instr->instr_type == BRANCH)
+        {
+            ++num_of_branches;
+            if (!predict(branch_predictor, instr))
+            {
+                ++num_of_incorrect_predictions;
+                branch_cycles += branch_penalty;
+            }
+        }
+        else if (instr->instr_type == LOAD)
+        {
+            if (!memAccess(mem_port, instr->PC, instr->load_or_store_addr, instr->size, false, now))
+            {
+                memory_cycles += load_penalty;
+            }
+        }
+        else if (instr->instr_type == STORE)
+        {
+            if (!memAccess(mem_port, instr->PC, instr->load_or_store_addr, instr->size, true, now))
+            {
+                memory_cycles += store_penalty;
+            }
+        }
+        ++num_of_instructions;
+
+        PROFILE_STAGE(STAGE_SIMULATE);
+        PROFILE_NEXT_RECORD();
+    }
+    PROFILE_END(PHASE_RUN);
+
+    PROFILE_BEGIN(PHASE_REPORT);
+
+    double base_cycles = (double)num_of_instructions / width;
+    double cycles = base_cycles + branch_cycles + memory_cycles;
+    uint64_t mem_accesses = mem_port->loads + mem_port->stores;
+    uint64_t mem_misses = mem_port->load_misses + mem_port->store_misses;
+
+    printf("File: %s\n", argv[optind]);
+    printf("Number of instructions: %"PRIu64"\n", num_of_instructions);
+    printf("Number of branches: %"PRIu64"\n", num_of_branches);
+    printf("Number of incorrect predictions: %"PRIu64"\n", num_of_incorrect_predictions);
+    printf("Predictor Correctness: %f%%\n", num_of_branches ?
+           100.0 * (num_of_branches - num_of_incorrect_predictions) / num_of_branches : 0);
+    printf("Branch MPKI: %f\n", num_of_instructions ?
+           1000.0 * num_of_incorrect_predictions / num_of_instructions : 0);
+    printf("Loads: %"PRIu64" (misses %"PRIu64"), Stores: %"PRIu64" (misses %"PRIu64")\n",
+           mem_port->loads, mem_port->load_misses, mem_port->stores, mem_port->store_misses);
+    printf("Writebacks: %"PRIu64"\n", mem_port->writebacks);
+    printf("Memory traffic: %"PRIu64" bytes read, %"PRIu64" bytes written\n",
+           mem_port->read_bytes, mem_port->write_bytes);
+    printf("Hit rate: %lf%%\n", mem_accesses ?
+           100.0 * (mem_accesses - mem_misses) / mem_accesses : 0);
+    printf("Cycles: %.0f\n", cycles);
+    if (num_of_instructions > 0)
+    {
+        printf("CPI: %f (base %f, branch %f, memory %f)\n",
+               cycles / num_of_instructions, base_cycles / num_of_instructions,
+               (double)branch_cycles / num_of_instructions,
+               (double)memory_cycles / num_of_instructions);
+    }
+    PROFILE_END(PHASE_REPORT);
+    PROFILE_REPORT();
+
+    // getInstruction() released the trace parser at the end of the trace
+    freeBranchPredictor(branch_predictor);
+    freeMemPort(mem_port);
+}
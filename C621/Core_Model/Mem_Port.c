@@ -0,0 +1,87 @@
+#include "Mem_Port.h"
+
+#include "Cache.h"
+
+Mem_Port *initMemPort(unsigned block_size, unsigned cache_size, unsigned assoc)
+{
+    Cache_Config config;
+    initCacheConfig(&config);
+    config.block_size = block_size;
+    config.cache_size = cache_size;
+    config.assoc = assoc;
+    if (!checkCacheConfig(&config))
+    {
+        return NULL;
+    }
+
+    Mem_Port *port = (Mem_Port *)calloc(1, sizeof(Mem_Port));
+
+    port->cache = initCacheGeometry(block_size, cache_size, assoc);
+    port->blk_mask = port->cache->blk_mask;
+
+    return port;
+}
+
+void freeMemPort(Mem_Port *port)
+{
+    freeCache(port->cache);
+    free(port);
+}
+
+bool memAccess(Mem_Port *port, uint64_t PC, uint64_t addr, int size, bool is_store, uint64_t time)
+{
+    Request req;
+    req.req_type = is_store ? STORE : LOAD;
+    req.PC = PC;
+    req.core_id = 0;
+
+    if (is_store)
+    {
+        ++port->stores;
+    }
+    else
+    {
+        ++port->loads;
+    }
+
+    uint64_t end = addr + (size > 0 ? size : 1);
+    uint64_t first = blkAlign(addr, port->blk_mask);
+    uint64_t last = blkAlign(end - 1, port->blk_mask);
+
+    bool hit = true;
+    uint64_t blk_addr;
+    for (blk_addr = first; blk_addr <= last; blk_addr += port->blk_mask + 1)
+    {
+        // The part of the access inside this block, for byte-accurate writes
+        uint64_t blk_end = blk_addr + port->blk_mask + 1;
+        req.load_or_store_addr = addr > blk_addr ? addr : blk_addr;
+        req.size = (end < blk_end ? end : blk_end) - req.load_or_store_addr;
+
+        if (accessBlock(port->cache, &req, time))
+        {
+            continue;
+        }
+
+        hit = false;
+
+        uint64_t wb_addr;
+        insertBlock(port->cache, &req, time, &wb_addr);
+    }
+
+    if (!hit)
+    {
+        if (is_store)
+        {
+            ++port->store_misses;
+        }
+        else
+        {
+            ++port->load_misses;
+        }
+    }
+    port->writebacks = port->cache->num_writebacks;
+    port->read_bytes = port->cache->read_bytes;
+    port->write_bytes = port->cache->write_bytes + pendingWriteBytes(port->cache);
+
+    return hit;
+}
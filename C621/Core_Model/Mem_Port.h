@@ -0,0 +1,33 @@
+#ifndef __MEM_PORT_HH__
+#define __MEM_PORT_HH__
+
+#include <stdbool.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h> // uint64_t
+
+// The Cache_Policy data cache behind a narrow interface. Request.h and
+// Instruction.h both define LOAD/STORE, so only Mem_Port.c sees the cache
+// headers and the core model only sees Instruction.h.
+typedef struct Mem_Port
+{
+    struct Cache *cache;
+    uint64_t blk_mask;
+
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t load_misses;
+    uint64_t store_misses;
+    uint64_t writebacks;
+    uint64_t read_bytes; // Traffic to the next level
+    uint64_t write_bytes;
+}Mem_Port;
+
+// NULL for a geometry the cache cannot be built with
+Mem_Port *initMemPort(unsigned block_size, unsigned cache_size, unsigned assoc);
+void freeMemPort(Mem_Port *port);
+
+// Access [addr, addr + size). An access that straddles a block boundary
+// touches every block it covers. Returns true if all blocks hit.
+bool memAccess(Mem_Port *port, uint64_t PC, uint64_t addr, int size, bool is_store, uint64_t time);
+
+#endif